@@ -1,6 +1,8 @@
 import os
 import signal
+import struct
 import subprocess
+import sys
 import threading
 from pathlib import Path
 
@@ -8,6 +10,9 @@ import tornado.ioloop
 import tornado.web
 import tornado.websocket
 
+# On Linux `ei_infer --ws 8765 --hop 25 --events` accepts the firmware
+# directly and makes this relay unnecessary; this server is kept for Windows.
+
 # ---------- Paths / globals ----------
 
 # repo root: one level above data-collection-pipeline
@@ -17,9 +22,22 @@ EI_INFER_PATH = ROOT / "model" / "build" / "ei_infer.exe"
 infer_proc = None
 batch_count = 0
 
-# confidence threshold for declaring a knock
+# confidence threshold for declaring a knock; ei_infer applies it (with
+# hysteresis and a refractory period) and only reports knock start/end
 KNOCK_THRESHOLD = 0.9
 
+# classify every N samples (25 samples = 50 ms at 500 Hz) instead of on every sample
+EI_INFER_HOP = 25
+
+# binary framing, must match model/ei_infer_protocol.h
+EI_INFER_EVENT_MAGIC = 0x56454945
+HEADER = struct.Struct("<IHHII")  # magic, version, label_count, window_size, hop
+LABEL_LEN = 32
+SAMPLE = struct.Struct("<ff")     # mic, imu
+EVENT = struct.Struct("<BBHQQf")  # type, label, reserved, sample_index, start_index, score
+EVENT_START = 1
+EVENT_END = 2
+
 
 def start_infer_process():
     global infer_proc
@@ -31,49 +49,61 @@ def start_infer_process():
     print(f"[INF] Starting EI process: {EI_INFER_PATH}")
 
     infer_proc = subprocess.Popen(
-        [str(EI_INFER_PATH)],
+        [str(EI_INFER_PATH), "--binary", "--hop", str(EI_INFER_HOP),
+         "--events", "--label", "knock", "--threshold", str(KNOCK_THRESHOLD)],
         stdin=subprocess.PIPE,
         stdout=subprocess.PIPE,
-        stderr=subprocess.STDOUT,
-        bufsize=0,      
-        text=False      
+        stderr=sys.stderr,
+        bufsize=0,
+        text=False
     )
 
-    def reader():
-        """Print everything the EI process writes to stdout and detect knocks."""
-        for raw in infer_proc.stdout:
-            try:
-                line = raw.decode("utf-8", errors="ignore").rstrip()
-            except AttributeError:
-                line = raw.rstrip()
-            if not line:
-                continue
-
-            # print("[EI]", line)
-
-            if line.startswith("PRED"):
-                parts = line.split()[1:]  # skip "PRED"
-                scores = {}
-                for p in parts:
-                    if "=" not in p:
-                        continue
-                    label, val = p.split("=", 1)
-                    try:
-                        scores[label] = float(val)
-                    except ValueError:
-                        continue
+    def read_exact(n):
+        buf = b""
+        while len(buf) < n:
+            chunk = infer_proc.stdout.read(n - len(buf))
+            if not chunk:
+                return None
+            buf += chunk
+        return buf
 
-                knock_score = scores.get("knock")
-                if knock_score is not None and knock_score >= KNOCK_THRESHOLD:
-                    print(">>> KNOCK DETECTED (score = {:.3f})".format(knock_score))
+    def reader():
+        """Read knock start/end events from the EI process."""
+        raw = read_exact(HEADER.size)
+        if raw is None:
+            return
+        magic, _version, label_count, _window_size, _hop = HEADER.unpack(raw)
+        if magic != EI_INFER_EVENT_MAGIC:
+            print("[ERR] unexpected header from EI process")
+            return
+
+        raw = read_exact(label_count * LABEL_LEN)
+        if raw is None:
+            return
+        labels = [raw[i * LABEL_LEN:(i + 1) * LABEL_LEN].rstrip(b"\0").decode("utf-8")
+                  for i in range(label_count)]
+
+        while True:
+            raw = read_exact(EVENT.size)
+            if raw is None:
+                return
+            kind, label, _reserved, sample_index, start_index, score = EVENT.unpack(raw)
+
+            if kind == EVENT_START:
+                print(">>> {} DETECTED at sample {} (score = {:.3f})".format(
+                    labels[label].upper(), start_index, score))
+            elif kind == EVENT_END:
+                print("<<< {} ended at sample {} (peak = {:.3f})".format(
+                    labels[label].upper(), sample_index, score))
 
     threading.Thread(target=reader, daemon=True).start()
 
 
-def send_to_infer(mic, imu):
+def send_to_infer(samples):
+    """Send a batch of (mic, imu) samples to the EI process in one write."""
     global infer_proc
 
-    if infer_proc is None or infer_proc.stdin is None:
+    if infer_proc is None or infer_proc.stdin is None or not samples:
         return
 
     # If the process has already exited, don't keep writing
@@ -82,9 +112,8 @@ def send_to_infer(mic, imu):
         return
 
     try:
-        msg = f"{mic},{imu}\n".encode("utf-8")
+        msg = b"".join(SAMPLE.pack(mic, imu) for mic, imu in samples)
         infer_proc.stdin.write(msg)
-        infer_proc.stdin.flush()
     except OSError as e:
         print(f"[WARN] Failed to write to EI stdin: {e}")
 
@@ -112,6 +141,7 @@ class WS(tornado.websocket.WebSocketHandler):
         print(f"Data received: Batch {batch_count}")
 
         # MCU is sending batched text with 1000 lines of "mic,imu"
+        samples = []
         for line in text.splitlines():
             line = line.strip()
             if not line:
@@ -131,8 +161,10 @@ class WS(tornado.websocket.WebSocketHandler):
                 # malformed line, skip
                 continue
 
-            # send each sample to the EI process
-            send_to_infer(mic, imu)
+            samples.append((mic, imu))
+
+        # send the whole batch to the EI process
+        send_to_infer(samples)
 
     def on_close(self):
         print("client disconnected")
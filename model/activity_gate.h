@@ -0,0 +1,132 @@
+#ifndef ACTIVITY_GATE_H
+#define ACTIVITY_GATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cheap check in front of the impulse: is there anything in the window at all?
+//
+// The door is quiet almost all of the time, and the gate assumes a window
+// with no movement above the floor is noise. The caller classifies the first
+// quiet window after activity and, if the model agrees (no hit on the watched
+// label), hands those scores out for the rest of the quiet stretch instead of
+// running the spectrogram, wavelet features and the NN. A quiet window the
+// model does call a hit is never cached, the impulse keeps running until a
+// quiet window comes out as noise. Still a heuristic, so pick the floor
+// against recorded data.
+//
+// The gate keeps running statistics of the IMU magnitude per hop
+// (peak-to-peak and variance, updated with every sample) and remembers until
+// when an active hop is still inside the window. A window is quiet when none
+// of the hops it overlaps reached the floor:
+//  - peak_to_peak_floor: a hop is active when max - min >= this
+//  - variance_floor: ... or when its variance >= this (0 = only peak-to-peak)
+//
+// Hops shorter than ACTIVITY_GATE_MIN_HOP samples are measured over that many
+// samples, the statistics over one or two samples don't say much. Each hop
+// starts from the last sample of the one before, so a step right at the
+// boundary still counts.
+static const size_t ACTIVITY_GATE_MIN_HOP = 16;
+
+class ActivityGate {
+public:
+    ActivityGate(size_t window_size, size_t hop, float peak_to_peak_floor, float variance_floor)
+        : window_size_(window_size)
+        , hop_(hop > ACTIVITY_GATE_MIN_HOP ? hop : ACTIVITY_GATE_MIN_HOP)
+        , peak_to_peak_floor_(peak_to_peak_floor)
+        , variance_floor_(variance_floor)
+    {
+        reset();
+    }
+
+    void reset() {
+        samples_seen_ = 0;
+        active_until_ = 0;
+        last_peak_to_peak_ = 0.0f;
+        last_variance_ = 0.0f;
+        start_hop(0.0f, false);
+    }
+
+    // Add the next sample, call once per sample in stream order
+    void push(float v) {
+        samples_seen_++;
+
+        if (!has_seed_ && count_ == 0) {
+            min_ = max_ = v;
+        }
+        if (v < min_) {
+            min_ = v;
+        }
+        if (v > max_) {
+            max_ = v;
+        }
+
+        // Welford, stable without keeping the samples around
+        count_++;
+        const double delta = v - mean_;
+        mean_ += delta / count_;
+        m2_ += delta * (v - mean_);
+
+        if (count_ == hop_) {
+            last_peak_to_peak_ = peak_to_peak();
+            last_variance_ = variance();
+            if (active()) {
+                // until this sample has slid out of the window
+                active_until_ = samples_seen_ + window_size_;
+            }
+            start_hop(v, true);
+        }
+    }
+
+    // True if the window ending at the last pushed sample has no active hop,
+    // including the one still being filled
+    bool quiet() const {
+        return samples_seen_ >= active_until_ && !active();
+    }
+
+    // Statistics of the last complete hop
+    float last_peak_to_peak() const { return last_peak_to_peak_; }
+    float last_variance() const { return last_variance_; }
+
+private:
+    void start_hop(float seed, bool has_seed) {
+        has_seed_ = has_seed;
+        min_ = max_ = seed;
+        count_ = 0;
+        mean_ = 0.0;
+        m2_ = 0.0;
+    }
+
+    float peak_to_peak() const {
+        return max_ - min_;
+    }
+
+    float variance() const {
+        return count_ > 1 ? (float)(m2_ / count_) : 0.0f;
+    }
+
+    // the hop being filled
+    bool active() const {
+        return peak_to_peak() >= peak_to_peak_floor_ ||
+               (variance_floor_ > 0.0f && variance() >= variance_floor_);
+    }
+
+    const size_t window_size_;
+    const size_t hop_;
+    const float peak_to_peak_floor_;
+    const float variance_floor_;
+
+    uint64_t samples_seen_;
+    uint64_t active_until_;  // windows ending before this sample hold an active hop
+    float last_peak_to_peak_;
+    float last_variance_;
+
+    bool has_seed_;
+    float min_;
+    float max_;
+    size_t count_;
+    double mean_;
+    double m2_;
+};
+
+#endif // ACTIVITY_GATE_H
@@ -0,0 +1,256 @@
+#include "batch_eval.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "sample_parse.h"
+
+namespace {
+
+// Windows handed to the classifier per call, the network runs once per call
+const size_t EVAL_BATCH = 32;
+
+struct Chunk {
+    const char *begin;
+    const char *end;
+    std::vector<float> imu;
+    uint64_t first_sample;  // global index of imu[0]
+    std::string out;        // formatted predictions for windows ending here
+    size_t windows;
+    size_t errors;
+};
+
+void parse_chunk(Chunk *chunk) {
+    const char *p = chunk->begin;
+    while (p < chunk->end) {
+        const char *eol = (const char *)memchr(p, '\n', chunk->end - p);
+        if (eol == nullptr) {
+            eol = chunk->end;
+        }
+        float imu;
+        if (parse_imu_line(p, eol, &imu)) {
+            chunk->imu.push_back(imu);
+        }
+        p = eol + 1;
+    }
+}
+
+// Copy samples [start, start + length) of the whole recording into out. The
+// range ends inside chunks[last] but may reach back into earlier chunks.
+void gather(const std::vector<Chunk> &chunks, size_t last, uint64_t start, size_t length, float *out) {
+    size_t ix = last;
+    while (chunks[ix].first_sample > start) {
+        ix--;
+    }
+    while (length > 0) {
+        const Chunk &c = chunks[ix++];
+        size_t from = (size_t)(start - c.first_sample);
+        if (from >= c.imu.size()) {
+            continue;
+        }
+        size_t n = c.imu.size() - from;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(out, c.imu.data() + from, n * sizeof(float));
+        out += n;
+        start += n;
+        length -= n;
+    }
+}
+
+void classify_chunk(std::vector<Chunk> *chunks, size_t ix, size_t window_size, size_t hop,
+                    size_t label_count, classify_batch_fn_t classify) {
+    Chunk &chunk = (*chunks)[ix];
+    std::vector<float> windows(EVAL_BATCH * window_size);
+    std::vector<uint64_t> ends(EVAL_BATCH);
+    std::vector<uint32_t> dsp_us(EVAL_BATCH), classification_us(EVAL_BATCH);
+    std::vector<float> scores(EVAL_BATCH * label_count);
+    char line[32];          // one number at a time
+
+    const uint64_t chunk_end = chunk.first_sample + chunk.imu.size();
+
+    // first window end (in samples seen) that falls inside this chunk
+    uint64_t e = window_size;
+    if (chunk.first_sample + 1 > e) {
+        uint64_t behind = chunk.first_sample + 1 - e;
+        e += (behind + hop - 1) / hop * hop;
+    }
+
+    while (e <= chunk_end) {
+        size_t count = 0;
+        for (; count < EVAL_BATCH && e <= chunk_end; count++, e += hop) {
+            gather(*chunks, ix, e - window_size, window_size, &windows[count * window_size]);
+            ends[count] = e;
+        }
+
+        if (!classify(windows.data(), count, window_size, dsp_us.data(), classification_us.data(),
+                      scores.data())) {
+            chunk.errors += count;
+            continue;
+        }
+        chunk.windows += count;
+
+        for (size_t wx = 0; wx < count; wx++) {
+            int n = snprintf(line, sizeof(line), "%llu", (unsigned long long)ends[wx]);
+            chunk.out.append(line, n);
+            for (size_t lx = 0; lx < label_count; lx++) {
+                n = snprintf(line, sizeof(line), ",%.5f", scores[wx * label_count + lx]);
+                chunk.out.append(line, n);
+            }
+            chunk.out.push_back('\n');
+        }
+    }
+}
+
+} // namespace
+
+int batch_eval(const char *path, size_t window_size, size_t hop, size_t threads,
+               const char **labels, size_t label_count, float frequency,
+               classify_batch_fn_t classify) {
+    uint64_t start_us = ei_read_timer_us();
+
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+#else
+    // text mode would drop the CRs and stop at a ^Z
+    int fd = open(path, O_RDONLY | O_BINARY);
+#endif
+    if (fd < 0) {
+        ei_printf("ERR: cannot open %s\n", path);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ei_printf("ERR: cannot stat %s\n", path);
+        close(fd);
+        return 1;
+    }
+    const size_t size = (size_t)st.st_size;
+
+#ifndef _WIN32
+    const char *data = nullptr;
+    if (size > 0) {
+        void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED) {
+            ei_printf("ERR: cannot mmap %s\n", path);
+            close(fd);
+            return 1;
+        }
+        madvise(m, size, MADV_SEQUENTIAL);
+        data = (const char *)m;
+    }
+#else
+    // no mmap on Windows, read it in one go instead
+    std::vector<char> file_buf(size);
+    size_t got = 0;
+    while (got < size) {
+        int n = read(fd, file_buf.data() + got, (unsigned)(size - got));
+        if (n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    const char *data = file_buf.data();
+#endif
+
+    // split on line boundaries, one chunk per thread
+    if (threads == 0) {
+        threads = 1;
+    }
+    std::vector<Chunk> chunks;
+    const char *p = data;
+    const char *file_end = data + size;
+    for (size_t ix = 0; ix < threads && p < file_end; ix++) {
+        const char *end = (ix == threads - 1) ? file_end : data + size / threads * (ix + 1);
+        if (end < p) {
+            end = p;
+        }
+        const char *eol = (const char *)memchr(end, '\n', file_end - end);
+        end = eol ? eol + 1 : file_end;
+
+        Chunk c;
+        c.begin = p;
+        c.end = end;
+        c.first_sample = 0;
+        c.windows = 0;
+        c.errors = 0;
+        chunks.push_back(c);
+        p = end;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t ix = 0; ix < chunks.size(); ix++) {
+        workers.push_back(std::thread(parse_chunk, &chunks[ix]));
+    }
+    for (size_t ix = 0; ix < workers.size(); ix++) {
+        workers[ix].join();
+    }
+    workers.clear();
+
+    uint64_t total_samples = 0;
+    for (size_t ix = 0; ix < chunks.size(); ix++) {
+        chunks[ix].first_sample = total_samples;
+        total_samples += chunks[ix].imu.size();
+    }
+
+    uint64_t parsed_us = ei_read_timer_us();
+
+    for (size_t ix = 0; ix < chunks.size(); ix++) {
+        workers.push_back(std::thread(classify_chunk, &chunks, ix, window_size, hop,
+                                      label_count, classify));
+    }
+    for (size_t ix = 0; ix < workers.size(); ix++) {
+        workers[ix].join();
+    }
+
+    std::string header = "sample_index";
+    for (size_t ix = 0; ix < label_count; ix++) {
+        header += ",";
+        header += labels[ix];
+    }
+    header += "\n";
+    std::fwrite(header.data(), 1, header.size(), stdout);
+
+    size_t windows = 0, errors = 0;
+    for (size_t ix = 0; ix < chunks.size(); ix++) {
+        std::fwrite(chunks[ix].out.data(), 1, chunks[ix].out.size(), stdout);
+        windows += chunks[ix].windows;
+        errors += chunks[ix].errors;
+    }
+    std::fflush(stdout);
+
+#ifndef _WIN32
+    if (data) {
+        munmap((void *)data, size);
+    }
+#endif
+    close(fd);
+
+    uint64_t end_us = ei_read_timer_us();
+    double total_s = (end_us - start_us) / 1e6;
+    double classify_s = (end_us - parsed_us) / 1e6;
+    double recorded_s = frequency > 0 ? total_samples / frequency : 0;
+
+    ei_printf("eval: %s: %llu samples, %lu windows (%lu errors), %lu threads\n",
+              path, (unsigned long long)total_samples, (unsigned long)windows,
+              (unsigned long)errors, (unsigned long)chunks.size());
+    ei_printf("eval: parse %.3f s, classify %.3f s, total %.3f s, %.1f windows/s, %.1fx real time\n",
+              (parsed_us - start_us) / 1e6, classify_s, total_s,
+              classify_s > 0 ? windows / classify_s : 0.0,
+              total_s > 0 ? recorded_s / total_s : 0.0);
+
+    return 0;
+}
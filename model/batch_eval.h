@@ -0,0 +1,24 @@
+#ifndef BATCH_EVAL_H
+#define BATCH_EVAL_H
+
+#include <stddef.h>
+
+#include "classify_fn.h"
+
+// Offline scoring of a recorded "mic,imu" CSV (as written by knock-server.py).
+//
+// The file is memory-mapped and split into one chunk per thread on line
+// boundaries. Every thread parses its chunk and classifies each window that
+// ends inside it; windows that start in an earlier chunk borrow the missing
+// samples from the preceding chunks, so the result is identical to streaming
+// the whole file through a single window. Each thread classifies its windows
+// in batches. Predictions are written to stdout
+// as CSV in file order ("sample_index,<label>,..."), and a throughput summary
+// goes to ei_printf.
+//
+// Returns 0 on success, non-zero if the file can't be read.
+int batch_eval(const char *path, size_t window_size, size_t hop, size_t threads,
+               const char **labels, size_t label_count, float frequency,
+               classify_batch_fn_t classify);
+
+#endif // BATCH_EVAL_H
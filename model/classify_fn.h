@@ -0,0 +1,25 @@
+#ifndef CLASSIFY_FN_H
+#define CLASSIFY_FN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+// Classify one contiguous window. Fills in timing and one score per label
+// and returns true on success. Implemented next to the SDK in
+// live_inference.cpp; may be called from several threads at once.
+typedef std::function<bool(const float *window, size_t window_size,
+                           uint32_t *dsp_us, uint32_t *classification_us,
+                           float *scores)> classify_fn_t;
+
+// Classify `count` windows of window_size samples each, stored back to back
+// in `windows`, with one run of the neural network over all of them. Fills
+// in timing per window and label_count scores per window (window after
+// window) and returns true on success. May be called from several threads
+// at once.
+typedef std::function<bool(const float *windows, size_t count, size_t window_size,
+                           uint32_t *dsp_us, uint32_t *classification_us,
+                           float *scores)> classify_batch_fn_t;
+
+#endif // CLASSIFY_FN_H
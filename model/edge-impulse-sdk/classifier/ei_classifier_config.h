@@ -95,6 +95,41 @@
     #define ESP_NN                                  1
 #endif
 
+// int8 fully connected layers on x86-64 hosts use AVX2 / VNNI kernels (picked at
+// runtime, falls back to the reference kernel on older CPUs). Not on Windows,
+// Win64 GCC doesn't align the stack for the __m256i accumulators (GCC PR 54412)
+#ifndef EI_CLASSIFIER_TFLITE_ENABLE_X86_SIMD
+    #if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(_WIN32)
+        #define EI_CLASSIFIER_TFLITE_ENABLE_X86_SIMD    1
+    #else
+        #define EI_CLASSIFIER_TFLITE_ENABLE_X86_SIMD    0
+    #endif
+#endif
+
+// EON models that are a plain int8 fully connected / softmax chain run it as a
+// single generated function instead of walking the TFLM node table. Off when a
+// vendor kernel library is in use, set to 0 to always go through TFLM.
+#ifndef EI_CLASSIFIER_TFLITE_FUSED_GRAPH
+    #if EI_CLASSIFIER_TFLITE_ENABLE_CMSIS_NN == 1 || EI_CLASSIFIER_TFLITE_ENABLE_ARC == 1 || \
+        EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN == 1 || EI_CLASSIFIER_TFLITE_ENABLE_SILABS_MVP == 1
+        #define EI_CLASSIFIER_TFLITE_FUSED_GRAPH        0
+    #else
+        #define EI_CLASSIFIER_TFLITE_FUSED_GRAPH        1
+    #endif
+#endif
+
+// EON models are set up (arena, init / prepare) once per impulse handle in
+// run_classifier_init() or on the first inference, and kept until the handle is
+// reset, so an inference only fills the input and invokes. Keeps the arena
+// allocated between inferences, so only on by default on hosted targets.
+#ifndef EI_CLASSIFIER_TFLITE_EON_PERSISTENT
+    #if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+        #define EI_CLASSIFIER_TFLITE_EON_PERSISTENT     1
+    #else
+        #define EI_CLASSIFIER_TFLITE_EON_PERSISTENT     0
+    #endif
+#endif
+
 // no include checks in the compiler? then just include metadata and then ops_define (optional if on EON model)
 #ifndef __has_include
     #include "model-parameters/model_metadata.h"
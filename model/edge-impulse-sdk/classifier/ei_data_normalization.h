@@ -187,6 +187,72 @@ EI_IMPULSE_ERROR data_normalization_standard_scaler(
     return ret;
 }
 
+/**
+ * Mean and scale of a DSP block's standard scaler, for consumers that apply
+ * it in the same pass as something else (e.g. quantizing the features into
+ * the NN input). Returns false if the block has no data normalization, or
+ * one that isn't a standard scaler matching its features.
+ */
+static bool get_data_normalization_standard_scaler(const ei_model_dsp_t *block,
+                                                   const float **mean,
+                                                   const float **scale)
+{
+    ei_data_normalization_t *dn_config = (ei_data_normalization_t *)block->data_normalization_config;
+    if (!dn_config || !dn_config->config || dn_config->exec_fn != &data_normalization_standard_scaler) {
+        return false;
+    }
+
+    ei_data_normalization_standard_scaler_config_t *sc_config = (ei_data_normalization_standard_scaler_config_t *) dn_config->config;
+    if (!sc_config->mean_data || !sc_config->scale_data || !sc_config->var_data
+        || sc_config->mean_data_len != block->n_output_features
+        || sc_config->scale_data_len != block->n_output_features
+        || sc_config->var_data_len == 0) {
+        return false;
+    }
+
+    *mean = sc_config->mean_data;
+    *scale = sc_config->scale_data;
+    return true;
+}
+
+/**
+ * Same as run_data_normalization, but standard scalers are not run: their
+ * constants are put on the features (pending_mean / pending_scale) and the
+ * learning block applies them while reading the features.
+ */
+static EI_IMPULSE_ERROR defer_data_normalization(ei_impulse_handle_t *handle,
+                                                 ei_feature_t *features)
+{
+    if (!handle) {
+        return EI_IMPULSE_OUT_OF_MEMORY;
+    }
+
+    auto impulse = handle->impulse;
+    for (size_t i = 0; i < impulse->dsp_blocks_size; i++) {
+        auto dsp_block = &impulse->dsp_blocks[i];
+        if (!dsp_block->data_normalization_config || !dsp_block->data_normalization_config->config) {
+            continue;
+        }
+
+        const float *mean, *scale;
+        if (features[i].matrix->rows == 1 && get_data_normalization_standard_scaler(dsp_block, &mean, &scale)) {
+            features[i].pending_mean = mean;
+            features[i].pending_scale = scale;
+            continue;
+        }
+
+        auto dn_config = dsp_block->data_normalization_config;
+        if (dn_config->exec_fn) {
+            EI_IMPULSE_ERROR res = dn_config->exec_fn((void*)dsp_block, features[i].matrix);
+            if (res != EI_IMPULSE_OK) {
+                return res;
+            }
+        }
+    }
+
+    return EI_IMPULSE_OK;
+}
+
 #endif // EI_CLASSIFIER_HAS_DATA_NORMALIZATION
 
 #endif // __EI_DATA_NORMALIZATION_H__
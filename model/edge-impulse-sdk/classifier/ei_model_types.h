@@ -37,6 +37,7 @@
 
 #include <stdint.h>
 
+#include "edge-impulse-sdk/classifier/ei_aligned_malloc.h"
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/dsp/ei_dsp_handle.h"
 #include "edge-impulse-sdk/dsp/numpy.hpp"
@@ -303,6 +304,17 @@ typedef struct {
     TfLiteStatus (*model_reset)(void (*free)(void* ptr));
     TfLiteStatus (*model_input)(int, TfLiteTensor*);
     TfLiteStatus (*model_output)(int, TfLiteTensor*);
+    // optional, runs several inputs per invoke (nullptr if the model can't)
+    size_t (*model_batch_arena_size)(size_t);
+    TfLiteStatus (*model_invoke_batch)(size_t, uint8_t*, const void*, void*);
+    // optional, the above on a caller-owned instance of the model state so
+    // several threads can run the model at once (nullptr if the model can't)
+    TfLiteStatus (*model_init_instance)(void**, void*(*alloc_fnc)(size_t, size_t));
+    TfLiteStatus (*model_input_instance)(void*, int, TfLiteTensor*);
+    TfLiteStatus (*model_output_instance)(void*, int, TfLiteTensor*);
+    TfLiteStatus (*model_invoke_instance)(void*);
+    TfLiteStatus (*model_invoke_batch_instance)(void*, size_t, uint8_t*, const void*, void*);
+    TfLiteStatus (*model_reset_instance)(void*, void (*free)(void* ptr));
 } ei_config_tflite_eon_graph_t;
 
 typedef struct {
@@ -413,18 +425,30 @@ typedef struct ei_impulse {
 
 class ei_impulse_state_t {
 typedef DspHandle* _dsp_handle_ptr_t;
+typedef struct {
+    void *state;
+    void (*free_fn)(void *state);
+} _learning_block_state_t;
 public:
     const ei_impulse_t *impulse; // keep a pointer to the impulse
     _dsp_handle_ptr_t *dsp_handles;
+    _learning_block_state_t *learning_block_states;
     bool is_temp_handle = false; // to know if we're using the old (stateless) API
+    bool has_printed_state_msg = false;
     ei_impulse_state_t(const ei_impulse_t *impulse)
         : impulse(impulse)
+        , raw_window(nullptr)
+        , raw_window_size(0)
+        , axes_window(nullptr)
+        , axes_window_size(0)
     {
         const auto num_dsp_blocks = impulse->dsp_blocks_size;
         dsp_handles = (_dsp_handle_ptr_t*)ei_malloc(sizeof(_dsp_handle_ptr_t)*num_dsp_blocks);
         for(size_t ix = 0; ix < num_dsp_blocks; ix++) {
             dsp_handles[ix] = nullptr;
         }
+        const auto num_learning_blocks = impulse->learning_blocks_size;
+        learning_block_states = (_learning_block_state_t*)ei_calloc(num_learning_blocks, sizeof(_learning_block_state_t));
     }
 
     DspHandle* get_dsp_handle(size_t ix) {
@@ -434,6 +458,35 @@ public:
         return dsp_handles[ix];
     }
 
+    /**
+     * State a learning block keeps between inferences (e.g. an EON model set
+     * up once), nullptr if it has none. Freed with `free_fn` on reset().
+     */
+    void *get_learning_block_state(size_t ix) {
+        return learning_block_states ? learning_block_states[ix].state : nullptr;
+    }
+
+    void set_learning_block_state(size_t ix, void *state, void (*free_fn)(void *state)) {
+        if (learning_block_states) {
+            learning_block_states[ix].state = state;
+            learning_block_states[ix].free_fn = free_fn;
+        }
+    }
+
+    /**
+     * Scratch for process_impulse(): the window fetched from the caller's
+     * signal once per inference, and that window narrowed down to one DSP
+     * block's axes. Both only grow and are 16-byte aligned.
+     * @returns nullptr if out of memory
+     */
+    float *get_raw_window(size_t length) {
+        return grow_buffer(&raw_window, &raw_window_size, length);
+    }
+
+    float *get_axes_window(size_t length) {
+        return grow_buffer(&axes_window, &axes_window_size, length);
+    }
+
     void reset()
     {
         for (size_t ix = 0; ix < impulse->dsp_blocks_size; ix++) {
@@ -442,8 +495,46 @@ public:
                 dsp_handles[ix] = nullptr;
             }
         }
+        for (size_t ix = 0; learning_block_states && ix < impulse->learning_blocks_size; ix++) {
+            if (learning_block_states[ix].state != nullptr) {
+                learning_block_states[ix].free_fn(learning_block_states[ix].state);
+                learning_block_states[ix].state = nullptr;
+            }
+        }
+        continuous_features_written = 0;
+        continuous_raw_window.clear();
+        continuous_raw_written = 0;
+    }
+
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    /**
+     * Classification arrays handed out in results, `count` results of
+     * `label_count` entries. Valid until the next inference on this handle.
+     */
+    ei_impulse_result_classification_t *get_classification_results(size_t count, size_t label_count) {
+        classification_results.resize(count * label_count);
+        return classification_results.data();
+    }
+#endif // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+
+    /**
+     * run_classifier_continuous(): the features of the current window, rolled
+     * in slice by slice, and how many have been written so far.
+     */
+    float *get_continuous_features() {
+        if (continuous_features.size() != impulse->nn_input_frame_size) {
+            continuous_features.assign(impulse->nn_input_frame_size, 0.0f);
+        }
+        return continuous_features.data();
     }
 
+    uint64_t continuous_features_written = 0;
+
+    // DSP blocks without a per-slice variant (e.g. spectral analysis) run on the
+    // full window every slice, so continuous mode keeps the last window of raw samples
+    ei_vector<float> continuous_raw_window;
+    uint64_t continuous_raw_written = 0;
+
     void* operator new(size_t size) {
         return ei_malloc(size);
     }
@@ -464,7 +555,38 @@ public:
     {
         reset();
         ei_free(dsp_handles);
+        ei_free(learning_block_states);
+        if (raw_window) {
+            ei_aligned_free(raw_window);
+        }
+        if (axes_window) {
+            ei_aligned_free(axes_window);
+        }
     }
+
+private:
+    static float *grow_buffer(float **buffer, size_t *size, size_t length) {
+        if (length == 0) {
+            length = 1;
+        }
+        if (*size < length) {
+            if (*buffer) {
+                ei_aligned_free(*buffer);
+            }
+            *buffer = (float *)ei_aligned_calloc(16, length * sizeof(float));
+            *size = *buffer ? length : 0;
+        }
+        return *buffer;
+    }
+
+    float *raw_window;
+    size_t raw_window_size;
+    float *axes_window;
+    size_t axes_window_size;
+    ei_vector<float> continuous_features;
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    ei_vector<ei_impulse_result_classification_t> classification_results;
+#endif
 };
 
 class ei_impulse_handle_t {
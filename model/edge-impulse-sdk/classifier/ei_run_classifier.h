@@ -48,6 +48,7 @@
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "edge-impulse-sdk/porting/ei_logging.h"
 #include <memory>
+#include <vector>
 
 #if EI_CLASSIFIER_LOAD_ANOMALY_H
 #include "inferencing_engines/anomaly.h"
@@ -100,6 +101,7 @@ namespace {
 
 /* Function prototypes ----------------------------------------------------- */
 extern "C" EI_IMPULSE_ERROR run_inference(ei_impulse_handle_t *handle, ei_feature_t *fmatrix, ei_impulse_result_t *result, bool debug);
+extern "C" EI_IMPULSE_ERROR run_inference_batch(ei_impulse_handle_t *handle, ei_feature_t **fmatrices, size_t count, ei_impulse_result_t *results, bool debug);
 extern "C" EI_IMPULSE_ERROR run_classifier_image_quantized(const ei_impulse_t *impulse, signal_t *signal, ei_impulse_result_t *result, bool debug);
 static EI_IMPULSE_ERROR can_run_classifier_image_quantized(const ei_impulse_t *impulse, ei_learning_block_t block_ptr);
 
@@ -108,15 +110,123 @@ EI_IMPULSE_ERROR ei_scale_fmatrix(ei_learning_block_t *block, ei::matrix_t *fmat
 EI_IMPULSE_ERROR ei_unscale_fmatrix(ei_learning_block_t *block, ei::matrix_t *fmatrix);
 #endif // EI_CLASSIFIER_LOAD_IMAGE_SCALING
 
-/* Private variables ------------------------------------------------------- */
-
-static uint64_t classifier_continuous_features_written = 0;
-
 /* Private functions ------------------------------------------------------- */
 
 /* These functions (up to Public functions section) are not exposed to end-user,
 therefore changes are allowed. */
 
+/**
+ * @brief      Shift a new slice of raw samples into the continuous raw window
+ *
+ * @param      handle   Handle the raw window belongs to
+ * @param      signal   Slice of raw samples
+ *
+ * @return     EIDSP_OK on success
+ */
+static int continuous_push_raw_slice(ei_impulse_handle_t *handle, signal_t *signal)
+{
+    ei_impulse_state_t &state = handle->state;
+    const size_t window_size = handle->impulse->dsp_input_frame_size;
+    const size_t slice_size = signal->total_length;
+
+    if (slice_size > window_size) {
+        ei_printf("ERR: Slice (%d) is larger than the window (%d)\n", (int)slice_size, (int)window_size);
+        return EIDSP_PARAMETER_INVALID;
+    }
+
+    if (state.continuous_raw_window.size() != window_size) {
+        state.continuous_raw_window.assign(window_size, 0.0f);
+        state.continuous_raw_written = 0;
+    }
+
+    float *buffer = state.continuous_raw_window.data();
+    memmove(buffer, buffer + slice_size, (window_size - slice_size) * sizeof(float));
+
+    int ret = signal->get_data(0, slice_size, buffer + window_size - slice_size);
+    if (ret != EIDSP_OK) {
+        return ret;
+    }
+
+    state.continuous_raw_written += slice_size;
+    return EIDSP_OK;
+}
+
+/**
+ * @brief      Samples of a window that a spectrogram block's frames cover. The
+ *             block trims the signal it is handed to that length, and in
+ *             process_impulse the blocks after it see the trimmed signal.
+ *
+ * @param      block      Spectrogram block
+ * @param      length     Samples in the window
+ * @param      frequency  Sampling frequency
+ *
+ * @return     The trimmed length, or length if it can't be framed
+ */
+static size_t spectrogram_framed_length(const ei_model_dsp_t &block, size_t length, float frequency)
+{
+    ei_dsp_config_spectrogram_t *config = (ei_dsp_config_spectrogram_t *)block.config;
+
+    // stack_frames() only looks at the length
+    signal_t frames_signal;
+    frames_signal.total_length = length;
+    frames_signal.get_data = [](size_t, size_t, float *) { return 0; };
+
+    speechpy::stack_frames_info_t info;
+    info.signal = &frames_signal;
+    int ret = speechpy::processing::stack_frames(&info, frequency, config->frame_length,
+        config->frame_stride, false, config->implementation_version);
+    if (ret != EIDSP_OK || frames_signal.total_length > length) {
+        return length;
+    }
+    return frames_signal.total_length;
+}
+
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+/**
+ * @brief      Number of classification entries in a result
+ */
+static size_t classification_label_count(const ei_impulse_t *impulse)
+{
+    if (impulse->results_type != EI_CLASSIFIER_TYPE_CLASSIFICATION &&
+        impulse->results_type != EI_CLASSIFIER_TYPE_REGRESSION) {
+        return 0;
+    }
+#ifdef EI_DSP_RESULT_OVERRIDE
+    return EI_DSP_RESULT_OVERRIDE;
+#else
+    return impulse->label_count;
+#endif // EI_DSP_RESULT_OVERRIDE
+}
+
+/**
+ * @brief      Labelled, zeroed classification arrays for `count` results, kept
+ *             on the handle so every handle can run inference on its own thread
+ *
+ * @param      handle  Handle that owns the arrays
+ * @param      count   Number of results
+ *
+ * @return     The arrays, result after result
+ */
+static ei_impulse_result_classification_t *init_classification_results(ei_impulse_handle_t *handle, size_t count)
+{
+    const size_t label_count = classification_label_count(handle->impulse);
+    ei_impulse_result_classification_t *classification_results =
+        handle->state.get_classification_results(count, label_count);
+
+    for (size_t item = 0; item < count; item++) {
+        for (size_t ix = 0; ix < label_count; ix++) {
+#ifdef EI_DSP_RESULT_OVERRIDE
+            classification_results[item * label_count + ix].label = "";
+#else
+            classification_results[item * label_count + ix].label = handle->impulse->categories[ix];
+#endif // EI_DSP_RESULT_OVERRIDE
+            classification_results[item * label_count + ix].value = 0.0f;
+        }
+    }
+    return classification_results;
+}
+#endif // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+
 /**
  * @brief      Display the results of the inference
  *
@@ -128,6 +238,40 @@ __attribute__((unused)) void display_results(ei_impulse_handle_t *handle, ei_imp
     display_postprocessing(handle, result);
 }
 
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_TFLITE_EON_PERSISTENT == 1)
+/**
+ * @brief      The EON model of a learning block, set up once and kept on the
+ *             handle until it's reset
+ *
+ * @param      handle  Handle that keeps the model
+ * @param      ix      Learning block index
+ *
+ * @return     The model, or nullptr if the block can't keep one (or setting it
+ *             up failed), then the block sets up its model on every inference.
+ */
+static void *persistent_nn_model(ei_impulse_handle_t *handle, size_t ix)
+{
+    ei_learning_block_t block = handle->impulse->learning_blocks[ix];
+    if (block.infer_fn != run_nn_inference || !can_keep_nn_model(block.config)) {
+        return nullptr;
+    }
+
+    void *model = handle->state.get_learning_block_state(ix);
+    if (!model) {
+        if (init_nn_model(block.config, &model) != EI_IMPULSE_OK) {
+            return nullptr;
+        }
+        handle->state.set_learning_block_state(ix, model, free_nn_model);
+        if (handle->state.get_learning_block_state(ix) != model) {
+            // handle has no room to keep it
+            free_nn_model(model);
+            return nullptr;
+        }
+    }
+    return model;
+}
+#endif
+
 /**
  * @brief      Do inferencing over the processed feature matrix
  *
@@ -158,7 +302,20 @@ extern "C" EI_IMPULSE_ERROR run_inference(
         }
 #endif
 
-        EI_IMPULSE_ERROR res = block.infer_fn(impulse, fmatrix, ix, (uint32_t*)block.input_block_ids, block.input_block_ids_size, result, block.config, debug);
+        void *model = nullptr;
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_TFLITE_EON_PERSISTENT == 1)
+        model = persistent_nn_model(handle, ix);
+#endif
+
+        EI_IMPULSE_ERROR res = EI_IMPULSE_OK;
+        if (model) {
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_TFLITE_EON_PERSISTENT == 1)
+            res = run_nn_inference_persistent(impulse, model, fmatrix, ix, (uint32_t*)block.input_block_ids, block.input_block_ids_size, result, block.config, debug);
+#endif
+        }
+        else {
+            res = block.infer_fn(impulse, fmatrix, ix, (uint32_t*)block.input_block_ids, block.input_block_ids_size, result, block.config, debug);
+        }
         if (res != EI_IMPULSE_OK) {
             return res;
         }
@@ -180,99 +337,151 @@ extern "C" EI_IMPULSE_ERROR run_inference(
 }
 
 /**
- * @brief      Process a complete impulse
+ * @brief      Do inferencing over several processed feature matrices at once
  *
- * @param      impulse  struct with information about model and DSP
- * @param      signal   Sample data
- * @param      result   Output classifier results
- * @param      handle   Handle from open_impulse. nullptr for backward compatibility
- * @param[in]  debug    Debug output enable
+ * Learning blocks that support it see all items as one input with `count`
+ * rows, the others run once per item.
+ *
+ * @param      handle     Handle from open_impulse
+ * @param      fmatrices  Processed matrices, one array of DSP block outputs per item
+ * @param      count      Number of items
+ * @param      results    Output classifier results, one per item
+ * @param[in]  debug      Debug output enable
  *
  * @return     The ei impulse error.
  */
-extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
-                                            signal_t *signal,
-                                            ei_impulse_result_t *result,
-                                            bool debug = false)
+extern "C" EI_IMPULSE_ERROR run_inference_batch(
+    ei_impulse_handle_t *handle,
+    ei_feature_t **fmatrices,
+    size_t count,
+    ei_impulse_result_t *results,
+    bool debug = false)
 {
-    if ((handle == nullptr) || (handle->impulse  == nullptr) || (result  == nullptr) || (signal  == nullptr)) {
-        return EI_IMPULSE_INFERENCE_ERROR;
-    }
-
-    memset(result, 0, sizeof(ei_impulse_result_t));
-
-#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
-    static std::vector<ei_impulse_result_classification_t> classification_results;
-    classification_results.clear(); // todo, should not clear and re-gen this every time...
-
-    if (handle->impulse->results_type == EI_CLASSIFIER_TYPE_CLASSIFICATION ||
-        handle->impulse->results_type == EI_CLASSIFIER_TYPE_REGRESSION) {
-    #ifdef EI_DSP_RESULT_OVERRIDE
-        for (size_t ix = 0; ix < EI_DSP_RESULT_OVERRIDE; ix++) {
-            ei_impulse_result_classification_t classification = {
-                .label = "",
-                .value = 0.0f
-            };
-            classification_results.push_back(classification);
-        }
-    #else
-        for (size_t ix = 0; ix < handle->impulse->label_count; ix++) {
-            ei_impulse_result_classification_t classification = {
-                .label = handle->impulse->categories[ix],
-                .value = 0.0f
-            };
-            classification_results.push_back(classification);
-        }
-    #endif // EI_DSP_RESULT_OVERRIDE
-    }
-
-    result->classification = classification_results.data();
-#endif // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    auto& impulse = handle->impulse;
+    for (size_t ix = 0; ix < impulse->learning_blocks_size; ix++) {
 
-    uint8_t num_results = handle->impulse->output_tensors_size;
+        ei_learning_block_t block = impulse->learning_blocks[ix];
 
-    std::unique_ptr<ei_feature_t[]> raw_results_ptr(new ei_feature_t[num_results]);
+#if EI_CLASSIFIER_LOAD_IMAGE_SCALING
+        for (size_t item = 0; item < count; item++) {
+            EI_IMPULSE_ERROR scale_res = ei_scale_fmatrix(&block, fmatrices[item][0].matrix);
+            if (scale_res != EI_IMPULSE_OK) {
+                return scale_res;
+            }
+        }
+#endif
 
-    result->_raw_outputs = raw_results_ptr.get();
-    memset(result->_raw_outputs, 0, sizeof(ei_feature_t) * num_results);
+        bool batched = false;
+        void *model = nullptr;
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1)
+        batched = block.infer_fn == run_nn_inference && can_run_nn_inference_batch(block.config);
+#if EI_CLASSIFIER_TFLITE_EON_PERSISTENT == 1
+        if (batched) {
+            model = persistent_nn_model(handle, ix);
+        }
+#endif
+#endif
 
-#if (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1 && (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TENSAIFLOW || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ONNX_TIDL) || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_DRPAI || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON)
-    // Shortcut for quantized image models
-    ei_learning_block_t block = handle->impulse->learning_blocks[0];
-    if (can_run_classifier_image_quantized(handle->impulse, block) == EI_IMPULSE_OK) {
-        EI_IMPULSE_ERROR res = run_classifier_image_quantized(handle->impulse, signal, result, debug);
+        EI_IMPULSE_ERROR res = EI_IMPULSE_OK;
+        if (batched) {
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1)
+            res = run_nn_inference_batch(impulse, fmatrices, count, ix, (uint32_t*)block.input_block_ids, block.input_block_ids_size, results, block.config, model, debug);
+#endif
+        }
+        else {
+            for (size_t item = 0; item < count && res == EI_IMPULSE_OK; item++) {
+                res = block.infer_fn(impulse, fmatrices[item], ix, (uint32_t*)block.input_block_ids, block.input_block_ids_size, &results[item], block.config, debug);
+            }
+        }
         if (res != EI_IMPULSE_OK) {
             return res;
         }
-        res = run_postprocessing(handle, result);
-        return res;
-    }
+
+#if EI_CLASSIFIER_LOAD_IMAGE_SCALING
+        // undo scaling
+        for (size_t item = 0; item < count; item++) {
+            EI_IMPULSE_ERROR scale_res = ei_unscale_fmatrix(&block, fmatrices[item][0].matrix);
+            if (scale_res != EI_IMPULSE_OK) {
+                return scale_res;
+            }
+        }
 #endif
+    }
 
-    uint32_t block_num = handle->impulse->dsp_blocks_size;
+    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+        return EI_IMPULSE_CANCELED;
+    }
 
-    // smart pointer to features array
-    std::unique_ptr<ei_feature_t[]> features_ptr(new ei_feature_t[block_num]);
-    ei_feature_t* features = features_ptr.get();
+    return EI_IMPULSE_OK;
+}
 
-    if (features == nullptr) {
-        ei_printf("ERR: Out of memory, can't allocate features\n");
-        return EI_IMPULSE_ALLOC_FAILED;
+/**
+ * Whether every learning block reads its DSP features through
+ * fill_input_tensor_from_matrix, which applies a pending standard scaler while
+ * quantizing them, so the separate normalization pass can be skipped
+ */
+static bool learning_blocks_apply_normalization(const ei_impulse_t *impulse)
+{
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1) && \
+    !EI_CLASSIFIER_LOAD_IMAGE_SCALING && !EI_CLASSIFIER_DSP_ONLY
+    if (impulse->learning_blocks_size == 0) {
+        return false;
+    }
+    for (size_t ix = 0; ix < impulse->learning_blocks_size; ix++) {
+        if (impulse->learning_blocks[ix].infer_fn != run_nn_inference) {
+            return false;
+        }
     }
+    return true;
+#else
+    (void)impulse;
+    return false;
+#endif
+}
 
-    memset(features, 0, sizeof(ei_feature_t) * block_num);
+/**
+ * @brief      Run the DSP blocks of the impulse over one window
+ *
+ * @param      handle       Handle from open_impulse
+ * @param      signal       Sample data
+ * @param      features     One entry per DSP block, filled in here
+ * @param      matrix_ptrs  One entry per DSP block, owns the feature matrices
+ * @param      result       Gets the DSP timing
+ * @param[in]  defer_normalization  Leave standard scalers to the learning
+ *                                  blocks (see defer_data_normalization)
+ * @param[in]  debug        Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+static EI_IMPULSE_ERROR extract_impulse_features(ei_impulse_handle_t *handle,
+                                                 signal_t *signal,
+                                                 ei_feature_t *features,
+                                                 std::unique_ptr<ei::matrix_t> *matrix_ptrs,
+                                                 ei_impulse_result_t *result,
+                                                 bool defer_normalization,
+                                                 bool debug)
+{
+    uint32_t block_num = handle->impulse->dsp_blocks_size;
 
-    // have it outside of the loop to avoid going out of scope
-    std::unique_ptr<std::unique_ptr<ei::matrix_t>[]> matrix_ptrs_ptr(new std::unique_ptr<ei::matrix_t>[block_num]);
-    std::unique_ptr<ei::matrix_t> *matrix_ptrs = matrix_ptrs_ptr.get();
 
-    if (matrix_ptrs == nullptr) {
-        delete[] matrix_ptrs;
-        ei_printf("ERR: Out of memory, can't allocate matrix_ptrs\n");
+    uint64_t dsp_start_us = ei_read_timer_us();
+
+#if !EIDSP_SIGNAL_C_FN_POINTER
+    // Fetch the window from the caller once, every block reads this copy
+    // rather than calling back into the signal per frame (or per sample when
+    // it only uses some of the axes)
+    float *raw_window = handle->state.get_raw_window(signal->total_length);
+    if (raw_window == nullptr) {
+        ei_printf("ERR: Out of memory, can't allocate raw window\n");
         return EI_IMPULSE_ALLOC_FAILED;
     }
-
-    uint64_t dsp_start_us = ei_read_timer_us();
+    if (signal->get_data(0, signal->total_length, raw_window) != 0) {
+        ei_printf("ERR: Failed to get data from signal\n");
+        return EI_IMPULSE_DSP_ERROR;
+    }
+    signal_t raw_signal;
+    numpy::signal_from_buffer(raw_window, signal->total_length, &raw_signal);
+#endif
 
     size_t out_features_index = 0;
 
@@ -287,7 +496,6 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
 
         if (matrix_ptrs[ix]->buffer == nullptr) {
             ei_printf("ERR: Out of memory, can't allocate matrix_ptrs[%lu]\n", (unsigned long)ix);
-            delete[] matrix_ptrs;
             return EI_IMPULSE_ALLOC_FAILED;
         }
 
@@ -306,21 +514,38 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
         }
         auto internal_signal = signal;
 #else
-        SignalWithAxes swa(signal, block.axes, block.axes_size, handle->impulse);
-        auto internal_signal = swa.get_signal();
+        signal_t axes_signal;
+        signal_t *internal_signal = &raw_signal;
+        if (block.axes_size != handle->impulse->raw_samples_per_frame) {
+            // same layout SignalWithAxes hands out, gathered in one go
+            const size_t frames = raw_signal.total_length / handle->impulse->raw_samples_per_frame;
+            float *axes_window = handle->state.get_axes_window(frames * block.axes_size);
+            if (axes_window == nullptr) {
+                ei_printf("ERR: Out of memory, can't allocate axes window\n");
+                return EI_IMPULSE_ALLOC_FAILED;
+            }
+            for (size_t frame = 0; frame < frames; frame++) {
+                const float *in = raw_window + frame * handle->impulse->raw_samples_per_frame;
+                for (size_t axis_ix = 0; axis_ix < block.axes_size; axis_ix++) {
+                    axes_window[frame * block.axes_size + axis_ix] = in[block.axes[axis_ix]];
+                }
+            }
+            numpy::signal_from_buffer(axes_window, frames * block.axes_size, &axes_signal);
+            internal_signal = &axes_signal;
+        }
 #endif
 
         int ret;
         if (block.factory) { // ie, if we're using state
-            // Msg user
-            static bool has_printed = false;
-            if (!has_printed) {
+            // getter has a lazy init, so we can just call it
+            auto dsp_handle = handle->state.get_dsp_handle(ix);
+
+            // Msg user (once per handle), not for handles that only cache work
+            if (dsp_handle && dsp_handle->keeps_state() && !handle->state.has_printed_state_msg) {
                 EI_LOGI("Impulse maintains state. Call run_classifier_init() to reset state (e.g. if data stream is interrupted.)\n");
-                has_printed = true;
+                handle->state.has_printed_state_msg = true;
             }
 
-            // getter has a lazy init, so we can just call it
-            auto dsp_handle = handle->state.get_dsp_handle(ix);
             if(dsp_handle) {
                 ret = dsp_handle->extract(
                     internal_signal,
@@ -348,12 +573,23 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
         out_features_index += block.n_output_features;
     }
 
+#if !EIDSP_SIGNAL_C_FN_POINTER
+    // blocks may shorten the window for the blocks after them (the
+    // spectrogram drops the samples past its last frame), pass that on to
+    // the caller's signal as when they read it directly
+    signal->total_length = raw_signal.total_length;
+#endif
+
 #if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
-    EI_IMPULSE_ERROR dn_error = run_data_normalization(handle, features);
+    EI_IMPULSE_ERROR dn_error = defer_normalization ?
+        defer_data_normalization(handle, features) :
+        run_data_normalization(handle, features);
     if (dn_error != EI_IMPULSE_OK) {
         ei_printf("ERR: Failed to run Data Normalization process (%d)\n", dn_error);
         return dn_error;
     }
+#else
+    (void)defer_normalization;
 #endif
 
     result->timing.dsp_us = ei_read_timer_us() - dsp_start_us;
@@ -373,6 +609,87 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
         }
     }
 
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Process a complete impulse
+ *
+ * @param      impulse  struct with information about model and DSP
+ * @param      signal   Sample data
+ * @param      result   Output classifier results
+ * @param      handle   Handle from open_impulse. nullptr for backward compatibility
+ * @param[in]  debug    Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
+                                            signal_t *signal,
+                                            ei_impulse_result_t *result,
+                                            bool debug = false)
+{
+    if ((handle == nullptr) || (handle->impulse  == nullptr) || (result  == nullptr) || (signal  == nullptr)) {
+        return EI_IMPULSE_INFERENCE_ERROR;
+    }
+
+    memset(result, 0, sizeof(ei_impulse_result_t));
+
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    result->classification = init_classification_results(handle, 1);
+#endif // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+
+    uint8_t num_results = handle->impulse->output_tensors_size;
+
+    std::unique_ptr<ei_feature_t[]> raw_results_ptr(new ei_feature_t[num_results]);
+
+    result->_raw_outputs = raw_results_ptr.get();
+    memset(result->_raw_outputs, 0, sizeof(ei_feature_t) * num_results);
+
+#if (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1 && (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TENSAIFLOW || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ONNX_TIDL) || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_DRPAI || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON)
+    // Shortcut for quantized image models
+    ei_learning_block_t block = handle->impulse->learning_blocks[0];
+    if (can_run_classifier_image_quantized(handle->impulse, block) == EI_IMPULSE_OK) {
+        EI_IMPULSE_ERROR res = run_classifier_image_quantized(handle->impulse, signal, result, debug);
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+        res = run_postprocessing(handle, result);
+        return res;
+    }
+#endif
+
+    uint32_t block_num = handle->impulse->dsp_blocks_size;
+
+    // smart pointer to features array
+    std::unique_ptr<ei_feature_t[]> features_ptr(new ei_feature_t[block_num]);
+    ei_feature_t* features = features_ptr.get();
+
+    if (features == nullptr) {
+        ei_printf("ERR: Out of memory, can't allocate features\n");
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+
+    memset(features, 0, sizeof(ei_feature_t) * block_num);
+
+    // have it outside of the loop to avoid going out of scope
+    std::unique_ptr<std::unique_ptr<ei::matrix_t>[]> matrix_ptrs_ptr(new std::unique_ptr<ei::matrix_t>[block_num]);
+    std::unique_ptr<ei::matrix_t> *matrix_ptrs = matrix_ptrs_ptr.get();
+
+    if (matrix_ptrs == nullptr) {
+        delete[] matrix_ptrs;
+        ei_printf("ERR: Out of memory, can't allocate matrix_ptrs\n");
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+
+    // debug prints the features, those have to be the normalized ones
+    const bool defer_normalization = !debug && learning_blocks_apply_normalization(handle->impulse);
+
+    EI_IMPULSE_ERROR dsp_res = extract_impulse_features(handle, signal, features, matrix_ptrs, result,
+                                                        defer_normalization, debug);
+    if (dsp_res != EI_IMPULSE_OK) {
+        return dsp_res;
+    }
+
     if (debug) {
         ei_printf("Running impulse...\n");
     }
@@ -390,6 +707,92 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
 #endif
 }
 
+/**
+ * @brief      Process a complete impulse over several windows
+ *
+ * Runs the DSP blocks over every window, then the learning blocks over all
+ * of them together (see run_inference_batch), then postprocessing per window
+ * in order. Each result gets its own classification array.
+ *
+ * @param      handle   Handle from open_impulse
+ * @param      signals  Sample data, one signal per window
+ * @param      count    Number of windows
+ * @param      results  Output classifier results, one per window
+ * @param[in]  debug    Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+extern "C" EI_IMPULSE_ERROR process_impulse_batch(ei_impulse_handle_t *handle,
+                                                  signal_t *signals,
+                                                  size_t count,
+                                                  ei_impulse_result_t *results,
+                                                  bool debug = false)
+{
+    if ((handle == nullptr) || (handle->impulse  == nullptr) || (results  == nullptr) || (signals  == nullptr)) {
+        return EI_IMPULSE_INFERENCE_ERROR;
+    }
+
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    const size_t label_count = classification_label_count(handle->impulse);
+    ei_impulse_result_classification_t *classification_results = init_classification_results(handle, count);
+#endif // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+
+    uint8_t num_results = handle->impulse->output_tensors_size;
+    uint32_t block_num = handle->impulse->dsp_blocks_size;
+
+    std::unique_ptr<ei_feature_t[]> raw_results_ptr(new ei_feature_t[count * num_results]);
+    std::unique_ptr<ei_feature_t[]> features_ptr(new ei_feature_t[count * block_num]);
+    std::unique_ptr<ei_feature_t*[]> fmatrices_ptr(new ei_feature_t*[count]);
+    std::unique_ptr<std::unique_ptr<ei::matrix_t>[]> matrix_ptrs_ptr(new std::unique_ptr<ei::matrix_t>[count * block_num]);
+
+    if (!raw_results_ptr || !features_ptr || !fmatrices_ptr || !matrix_ptrs_ptr) {
+        ei_printf("ERR: Out of memory, can't allocate features\n");
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+
+    memset(raw_results_ptr.get(), 0, sizeof(ei_feature_t) * count * num_results);
+    memset(features_ptr.get(), 0, sizeof(ei_feature_t) * count * block_num);
+
+    ei_feature_t **fmatrices = fmatrices_ptr.get();
+
+    const bool defer_normalization = !debug && learning_blocks_apply_normalization(handle->impulse);
+
+    for (size_t item = 0; item < count; item++) {
+        ei_impulse_result_t *result = &results[item];
+
+        memset(result, 0, sizeof(ei_impulse_result_t));
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+        result->classification = classification_results + item * label_count;
+#endif
+        result->_raw_outputs = raw_results_ptr.get() + item * num_results;
+        fmatrices[item] = features_ptr.get() + item * block_num;
+
+        EI_IMPULSE_ERROR dsp_res = extract_impulse_features(handle, &signals[item], fmatrices[item],
+                                                            matrix_ptrs_ptr.get() + item * block_num,
+                                                            result, defer_normalization, debug);
+        if (dsp_res != EI_IMPULSE_OK) {
+            return dsp_res;
+        }
+    }
+
+#if EI_CLASSIFIER_DSP_ONLY
+    return EI_IMPULSE_OK;
+#else
+    EI_IMPULSE_ERROR res = run_inference_batch(handle, fmatrices, count, results, debug);
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
+
+    for (size_t item = 0; item < count; item++) {
+        res = run_postprocessing(handle, &results[item]);
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+    }
+    return EI_IMPULSE_OK;
+#endif
+}
+
 /**
  * @brief      Opens an impulse
  *
@@ -402,6 +805,13 @@ extern "C" EI_IMPULSE_ERROR init_impulse(ei_impulse_handle_t *handle) {
         return EI_IMPULSE_OUT_OF_MEMORY;
     }
     handle->state.reset();
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_TFLITE_EON_PERSISTENT == 1)
+    // set the models up now rather than on the first inference; if that fails
+    // the first inference tries again (or sets up per inference)
+    for (size_t ix = 0; ix < handle->impulse->learning_blocks_size; ix++) {
+        persistent_nn_model(handle, ix);
+    }
+#endif
     return EI_IMPULSE_OK;
 }
 
@@ -427,31 +837,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
     memset(result, 0, sizeof(ei_impulse_result_t));
 
 #if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
-    static std::vector<ei_impulse_result_classification_t> classification_results;
-    classification_results.clear(); // todo, should not clear and re-gen this every time...
-
-    if (handle->impulse->results_type == EI_CLASSIFIER_TYPE_CLASSIFICATION ||
-        handle->impulse->results_type == EI_CLASSIFIER_TYPE_REGRESSION) {
-    #ifdef EI_DSP_RESULT_OVERRIDE
-        for (size_t ix = 0; ix < EI_DSP_RESULT_OVERRIDE; ix++) {
-            ei_impulse_result_classification_t classification = {
-                .label = "",
-                .value = 0.0f
-            };
-            classification_results.push_back(classification);
-        }
-    #else
-        for (size_t ix = 0; ix < handle->impulse->label_count; ix++) {
-            ei_impulse_result_classification_t classification = {
-                .label = handle->impulse->categories[ix],
-                .value = 0.0f
-            };
-            classification_results.push_back(classification);
-        }
-    #endif
-    }
-
-    result->classification = classification_results.data();
+    result->classification = init_classification_results(handle, 1);
 
 #else // EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 1
 
@@ -468,8 +854,9 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
     memset(result->_raw_outputs, 0, sizeof(ei_feature_t) * handle->impulse->learning_blocks_size);
 
     auto impulse = handle->impulse;
-    static ei::matrix_t static_features_matrix(1, impulse->nn_input_frame_size);
-    if (!static_features_matrix.buffer) {
+    ei_impulse_state_t &state = handle->state;
+    float *continuous_features = state.get_continuous_features();
+    if (!continuous_features) {
         return EI_IMPULSE_ALLOC_FAILED;
     }
 
@@ -478,6 +865,10 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
     uint64_t dsp_start_us = ei_read_timer_us();
 
     size_t out_features_index = 0;
+    bool raw_slice_pushed = false;
+    // samples of the raw window the spectral analysis block sees, trimmed
+    // by the spectrogram blocks before it as in process_impulse
+    size_t raw_window_length = impulse->dsp_input_frame_size;
 
     for (size_t ix = 0; ix < impulse->dsp_blocks_size; ix++) {
         ei_model_dsp_t block = impulse->dsp_blocks[ix];
@@ -488,7 +879,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
         }
 
         ei::matrix_t fm(1, block.n_output_features,
-                        static_features_matrix.buffer + out_features_index);
+                        continuous_features + out_features_index);
 
         int (*extract_fn_slice)(ei::signal_t *signal, ei::matrix_t *output_matrix, void *config, const float frequency, matrix_size_t *out_matrix_size);
 
@@ -502,13 +893,67 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
         else if (block.extract_fn == extract_mfe_features) {
             extract_fn_slice = &extract_mfe_per_slice_features;
         }
+        else if (block.extract_fn == extract_spectral_analysis_features) {
+            extract_fn_slice = nullptr;
+        }
         else {
-            ei_printf("ERR: Unknown extract function, only MFCC, MFE and spectrogram supported\n");
+            ei_printf("ERR: Unknown extract function, only MFCC, MFE, spectrogram and spectral analysis supported\n");
             return EI_IMPULSE_DSP_ERROR;
         }
 
         matrix_size_t features_written;
 
+        /* No per-slice variant: re-run the block over the sliding raw window,
+           its features replace the previous ones instead of being rolled in */
+        if (extract_fn_slice == nullptr) {
+#if EIDSP_SIGNAL_C_FN_POINTER
+            ei_printf("ERR: EIDSP_SIGNAL_C_FN_POINTER is not supported for spectral analysis in continuous mode\n");
+            return EI_IMPULSE_DSP_ERROR;
+#else
+            if (!raw_slice_pushed) {
+                if (continuous_push_raw_slice(handle, signal) != EIDSP_OK) {
+                    ei_printf("ERR: Failed to buffer raw slice\n");
+                    return EI_IMPULSE_DSP_ERROR;
+                }
+                raw_slice_pushed = true;
+            }
+
+            // nothing useful to compute until the first full window is in
+            if (state.continuous_raw_written < impulse->dsp_input_frame_size) {
+                out_features_index += block.n_output_features;
+                continue;
+            }
+
+            signal_t window_signal;
+            numpy::signal_from_buffer(state.continuous_raw_window.data(),
+                                      raw_window_length, &window_signal);
+            SignalWithAxes swa(&window_signal, block.axes, block.axes_size, impulse);
+            int ret;
+            if (block.factory) {
+                auto dsp_handle = handle->state.get_dsp_handle(ix);
+                if (!dsp_handle) {
+                    return EI_IMPULSE_OUT_OF_MEMORY;
+                }
+                ret = dsp_handle->extract(swa.get_signal(), &fm, block.config, impulse->frequency, result);
+            }
+            else {
+                ret = block.extract_fn(swa.get_signal(), &fm, block.config, impulse->frequency);
+            }
+            if (ret != EIDSP_OK) {
+                ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
+                return EI_IMPULSE_DSP_ERROR;
+            }
+
+            if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+                return EI_IMPULSE_CANCELED;
+            }
+
+            state.continuous_features_written += block.n_output_features;
+            out_features_index += block.n_output_features;
+            continue;
+#endif
+        }
+
 #if EIDSP_SIGNAL_C_FN_POINTER
         if (block.axes_size != impulse->raw_samples_per_frame) {
             ei_printf("ERR: EIDSP_SIGNAL_C_FN_POINTER can only be used when all axes are selected for DSP blocks\n");
@@ -516,6 +961,12 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
         }
         int ret = extract_fn_slice(signal, &fm, block.config, impulse->frequency, &features_written);
 #else
+        // only a block on all axes gets (and trims) the caller's signal
+        if (block.extract_fn == extract_spectrogram_features &&
+            block.axes_size == impulse->raw_samples_per_frame) {
+            raw_window_length = spectrogram_framed_length(block, raw_window_length, impulse->frequency);
+        }
+
         SignalWithAxes swa(signal, block.axes, block.axes_size, impulse);
         int ret = extract_fn_slice(swa.get_signal(), &fm, block.config, impulse->frequency, &features_written);
 #endif
@@ -529,7 +980,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
             return EI_IMPULSE_CANCELED;
         }
 
-        classifier_continuous_features_written += (features_written.rows * features_written.cols);
+        state.continuous_features_written += (features_written.rows * features_written.cols);
 
         out_features_index += block.n_output_features;
     }
@@ -537,7 +988,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
     result->timing.dsp_us = ei_read_timer_us() - dsp_start_us;
     result->timing.dsp = (int)(result->timing.dsp_us / 1000);
 
-    if (classifier_continuous_features_written >= impulse->nn_input_frame_size) {
+    if (state.continuous_features_written >= impulse->nn_input_frame_size) {
         dsp_start_us = ei_read_timer_us();
 
         uint32_t block_num = impulse->dsp_blocks_size + impulse->learning_blocks_size;
@@ -580,7 +1031,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
 
             /* Create a copy of the matrix for normalization */
             for (size_t m_ix = 0; m_ix < block.n_output_features; m_ix++) {
-                features[ix].matrix->buffer[m_ix] = static_features_matrix.buffer[out_features_index + m_ix];
+                features[ix].matrix->buffer[m_ix] = continuous_features[out_features_index + m_ix];
             }
 
             if (block.extract_fn == extract_mfcc_features) {
@@ -595,6 +1046,15 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
             out_features_index += block.n_output_features;
         }
 
+#if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
+        EI_IMPULSE_ERROR dn_error = run_data_normalization(handle, features);
+        if (dn_error != EI_IMPULSE_OK) {
+            ei_printf("ERR: Failed to run Data Normalization process (%d)\n", dn_error);
+            delete[] matrix_ptrs;
+            return dn_error;
+        }
+#endif
+
         result->timing.dsp_us += ei_read_timer_us() - dsp_start_us;
         result->timing.dsp = (int)(result->timing.dsp_us / 1000);
 
@@ -831,8 +1291,6 @@ will be documented by Doxygen. */
  */
 extern "C" void run_classifier_init(void)
 {
-
-    classifier_continuous_features_written = 0;
     ei_dsp_clear_continuous_audio_state();
     init_impulse(&ei_default_impulse);
     init_postprocessing(&ei_default_impulse);
@@ -857,7 +1315,6 @@ extern "C" void run_classifier_init(void)
  */
 __attribute__((unused)) void run_classifier_init(ei_impulse_handle_t *handle)
 {
-    classifier_continuous_features_written = 0;
     ei_dsp_clear_continuous_audio_state();
     init_impulse(handle);
     init_postprocessing(handle);
@@ -1044,6 +1501,10 @@ extern "C" EI_IMPULSE_ERROR run_classifier(
  * of images, etc.) before performing inference. Results from inference are stored in an
  * `ei_impulse_result_t` struct.
  *
+ * A handle keeps its own DSP state, result buffers and continuous window, and
+ * EON compiled models run on a separate instance of their state per
+ * inference, so threads can classify at the same time with one handle each.
+ *
  * **Blocking**: yes
  *
  * **Example**: [standalone inferencing main.cpp](https://github.com/edgeimpulse/example-standalone-inferencing/blob/master/source/main.cpp)
@@ -1069,6 +1530,65 @@ __attribute__((unused)) EI_IMPULSE_ERROR run_classifier(
     return process_impulse(impulse, signal, result, debug);
 }
 
+/**
+ * @brief Run the classifier over several raw features arrays at once.
+ *
+ * Overloaded function [run_classifier_batch()](#run_classifier_batch-1) that defaults to the single impulse.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] signals Array of `count` `signal_t` structs, one window each.
+ * @param[in] count Number of windows.
+ * @param[out] results Array of `count` ei_impulse_result_t structs, one per window.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. Will be `EI_IMPULSE_OK` if inference
+ *  completed successfully.
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier_batch(
+    signal_t *signals,
+    size_t count,
+    ei_impulse_result_t *results,
+    bool debug = false)
+{
+    return process_impulse_batch(&ei_default_impulse, signals, count, results, debug);
+}
+
+/**
+ * @brief Run the classifier over several raw features arrays at once.
+ *
+ * Same as calling `run_classifier()` on each window in turn, but the neural
+ * network runs once over all windows (one input row per window) instead of
+ * once per window, which is much cheaper when many windows are ready at the
+ * same time, e.g. for offline scoring. The results are the same as
+ * `run_classifier()`'s; the classification time of each result is its share
+ * of the batch.
+ *
+ * The classification arrays in `results` stay valid until the next call on
+ * the same handle.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] impulse Pointer to an `ei_impulse_handle_t` struct that contains the model and
+ *  preprocessing information.
+ * @param[in] signals Array of `count` `signal_t` structs, one window each.
+ * @param[in] count Number of windows.
+ * @param[out] results Array of `count` ei_impulse_result_t structs, one per window.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. Will be `EI_IMPULSE_OK` if inference
+ *  completed successfully.
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR run_classifier_batch(
+    ei_impulse_handle_t *impulse,
+    signal_t *signals,
+    size_t count,
+    ei_impulse_result_t *results,
+    bool debug = false)
+{
+    return process_impulse_batch(impulse, signals, count, results, debug);
+}
+
 #if EI_CLASSIFIER_FREEFORM_OUTPUT
 /**
  * Set the location for freeform outputs. For impulses with freeform output the application needs to allocate
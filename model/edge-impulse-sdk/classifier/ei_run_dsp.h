@@ -40,6 +40,7 @@
 #include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
 #include "edge-impulse-sdk/classifier/ei_signal_with_range.h"
 #include "edge-impulse-sdk/dsp/ei_flatten.h"
+#include "edge-impulse-sdk/dsp/ei_spectrogram_cache.h"
 #include "model-parameters/model_metadata.h"
 
 #if EI_CLASSIFIER_HR_ENABLED
@@ -1522,4 +1523,7 @@ __attribute__((unused)) void calc_cepstral_mean_and_var_normalization_spectrogra
 }
 #endif // __cplusplus
 
+// stateful blocks that fall back on the extract functions above
+#include "edge-impulse-sdk/dsp/ei_spectral_analysis.h"
+
 #endif // _EDGE_IMPULSE_RUN_DSP_H_
@@ -44,29 +44,89 @@
 #include "edge-impulse-sdk/classifier/inferencing_engines/tflite_helper.h"
 #include "edge-impulse-sdk/classifier/ei_run_dsp.h"
 
+/**
+ * The compiled model as used by one inference. Models that have instances get
+ * a fresh one per inference, so inferences on different threads don't share an
+ * arena. Older models only have their one global state.
+ */
+typedef struct {
+    ei_config_tflite_eon_graph_t *graph_config;
+    void *instance;
+} ei_eon_model_t;
+
+static bool eon_model_has_instances(const ei_config_tflite_eon_graph_t *graph_config) {
+    return graph_config->model_init_instance != nullptr;
+}
+
+static TfLiteStatus eon_model_init(ei_eon_model_t *model) {
+    if (eon_model_has_instances(model->graph_config)) {
+        return model->graph_config->model_init_instance(&model->instance, ei_aligned_calloc);
+    }
+    return model->graph_config->model_init(ei_aligned_calloc);
+}
+
+static TfLiteStatus eon_model_input(ei_eon_model_t *model, int index, TfLiteTensor *tensor) {
+    if (eon_model_has_instances(model->graph_config)) {
+        return model->graph_config->model_input_instance(model->instance, index, tensor);
+    }
+    return model->graph_config->model_input(index, tensor);
+}
+
+static TfLiteStatus eon_model_output(ei_eon_model_t *model, int index, TfLiteTensor *tensor) {
+    if (eon_model_has_instances(model->graph_config)) {
+        return model->graph_config->model_output_instance(model->instance, index, tensor);
+    }
+    return model->graph_config->model_output(index, tensor);
+}
+
+static TfLiteStatus eon_model_invoke(ei_eon_model_t *model) {
+    if (eon_model_has_instances(model->graph_config)) {
+        return model->graph_config->model_invoke_instance(model->instance);
+    }
+    return model->graph_config->model_invoke();
+}
+
+static TfLiteStatus eon_model_invoke_batch(ei_eon_model_t *model, size_t batches, uint8_t *arena,
+                                           const void *input, void *output) {
+    if (eon_model_has_instances(model->graph_config)) {
+        return model->graph_config->model_invoke_batch_instance(model->instance, batches, arena, input, output);
+    }
+    return model->graph_config->model_invoke_batch(batches, arena, input, output);
+}
+
+static TfLiteStatus eon_model_reset(ei_eon_model_t *model) {
+    if (eon_model_has_instances(model->graph_config)) {
+        TfLiteStatus status = model->graph_config->model_reset_instance(model->instance, ei_aligned_free);
+        model->instance = nullptr;
+        return status;
+    }
+    return model->graph_config->model_reset(ei_aligned_free);
+}
+
 /**
  * Setup the TFLite runtime
  *
+ * @param      model              The model, gets its state initialized
  * @param      ctx_start_us       Pointer to the start time
  * @param      input              Pointer to input tensor
  * @param      output             Pointer to output tensor
- * @param      micro_tensor_arena Pointer to the arena that will be allocated
  *
  * @return  EI_IMPULSE_OK if successful
  */
 static EI_IMPULSE_ERROR inference_tflite_setup(
     ei_learning_block_config_tflite_graph_t *block_config,
+    ei_eon_model_t *model,
     uint64_t *ctx_start_us,
     TfLiteTensor* input,
-    TfLiteTensor** output_arg,
-    ei_unique_ptr_t& p_tensor_arena) {
+    TfLiteTensor** output_arg) {
 
     *ctx_start_us = ei_read_timer_us();
 
     TfLiteTensor *outputs = *output_arg;
-    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+    model->graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+    model->instance = nullptr;
 
-    TfLiteStatus init_status = graph_config->model_init(ei_aligned_calloc);
+    TfLiteStatus init_status = eon_model_init(model);
     if (init_status != kTfLiteOk) {
         ei_printf("Failed to initialize the model (error code %d)\n", init_status);
         return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
@@ -74,13 +134,13 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
 
     TfLiteStatus status;
 
-    status = graph_config->model_input(0, input);
+    status = eon_model_input(model, 0, input);
     if (status != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
 
     for (uint8_t i = 0; i < block_config->output_tensors_size; i++) {
-        status = graph_config->model_output(block_config->output_tensors_indices[i], &outputs[i]);
+        status = eon_model_output(model, block_config->output_tensors_indices[i], &outputs[i]);
         if (status != kTfLiteOk) {
             return EI_IMPULSE_TFLITE_ERROR;
         }
@@ -92,10 +152,9 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
 /**
  * Run TFLite model
  *
+ * @param   model           The model, set up by inference_tflite_setup
  * @param   ctx_start_us    Start time of the setup function (see above)
  * @param   output          Output tensor
- * @param   interpreter     TFLite interpreter (non-compiled models)
- * @param   tensor_arena    Allocated arena (will be freed)
  * @param   result          Struct for results
  * @param   debug           Whether to print debug info
  *
@@ -103,16 +162,13 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
  */
 static EI_IMPULSE_ERROR inference_tflite_run(
     const ei_impulse_t *impulse,
-    ei_learning_block_config_tflite_graph_t *block_config,
+    ei_eon_model_t *model,
     uint64_t ctx_start_us,
     TfLiteTensor** outputs,
-    uint8_t* tensor_arena,
     ei_impulse_result_t *result,
     bool debug) {
 
-    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
-
-    if (graph_config->model_invoke() != kTfLiteOk) {
+    if (eon_model_invoke(model) != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
 
@@ -151,15 +207,14 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
     outputs = (TfLiteTensor*)ei_malloc(block_config->output_tensors_size * sizeof(TfLiteTensor));
 
     uint64_t ctx_start_us = ei_read_timer_us();
-    ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
-    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+    ei_eon_model_t model;
 
     EI_IMPULSE_ERROR init_res = inference_tflite_setup(
         block_config,
+        &model,
         &ctx_start_us,
         &input,
-        &outputs,
-        p_tensor_arena);
+        &outputs);
 
     if (init_res != EI_IMPULSE_OK) {
         return init_res;
@@ -171,7 +226,7 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
     }
 
     // invoke the model
-    if (graph_config->model_invoke() != kTfLiteOk) {
+    if (eon_model_invoke(&model) != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
 
@@ -180,7 +235,7 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
         return output_res;
     }
 
-    if (graph_config->model_reset(ei_aligned_free) != kTfLiteOk) {
+    if (eon_model_reset(&model) != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
     ei_free(outputs);
@@ -189,67 +244,19 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
 }
 
 /**
- * @brief      Do neural network inferencing over a feature matrix
+ * Copy the output tensors into the raw outputs of the result
  *
- * @param      fmatrix  Processed matrix
- * @param      result   Output classifier results
- * @param[in]  debug    Debug output enable
+ * @param      outputs            Output tensors
+ * @param      learn_block_index  Index of the learning block
+ * @param      result             Result that gets the raw outputs
  *
- * @return     The ei impulse error.
+ * @return  EI_IMPULSE_OK if successful
  */
-EI_IMPULSE_ERROR run_nn_inference(
-    const ei_impulse_t *impulse,
-    ei_feature_t *fmatrix,
+static EI_IMPULSE_ERROR inference_tflite_store_outputs(
+    ei_learning_block_config_tflite_graph_t *block_config,
+    TfLiteTensor *outputs,
     uint32_t learn_block_index,
-    uint32_t* input_block_ids,
-    uint32_t input_block_ids_size,
-    ei_impulse_result_t *result,
-    void *config_ptr,
-    bool debug = false)
-{
-    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
-    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
-
-    TfLiteTensor input;
-    TfLiteTensor *outputs;
-
-    // allocate outputs
-    outputs = (TfLiteTensor*)ei_malloc(block_config->output_tensors_size * sizeof(TfLiteTensor));
-
-    uint64_t ctx_start_us = ei_read_timer_us();
-    ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
-
-    EI_IMPULSE_ERROR init_res = inference_tflite_setup(
-        block_config,
-        &ctx_start_us,
-        &input,
-        &outputs,
-        p_tensor_arena);
-
-    if (init_res != EI_IMPULSE_OK) {
-        return init_res;
-    }
-
-    uint8_t* tensor_arena = static_cast<uint8_t*>(p_tensor_arena.get());
-
-    auto input_res = fill_input_tensor_from_matrix(fmatrix,
-                                                   result->_raw_outputs,
-                                                   &input,
-                                                   input_block_ids,
-                                                   input_block_ids_size,
-                                                   impulse->dsp_blocks_size,
-                                                   impulse->learning_blocks_size);
-
-    if (input_res != EI_IMPULSE_OK) {
-        return input_res;
-    }
-
-    EI_IMPULSE_ERROR run_res = inference_tflite_run(
-        impulse,
-        block_config,
-        ctx_start_us,
-        &outputs,
-        tensor_arena, result, debug);
+    ei_impulse_result_t *result) {
 
     for (uint32_t output_ix = 0; output_ix < block_config->output_tensors_size; output_ix++) {
         TfLiteTensor* output = &outputs[output_ix];
@@ -295,11 +302,345 @@ EI_IMPULSE_ERROR run_nn_inference(
         result->_raw_outputs[learn_block_index + output_ix].blockId = block_config->block_id + output_ix;
     }
 
-    graph_config->model_reset(ei_aligned_free);
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * Quantize the features into the input tensor, invoke the model and store the
+ * outputs in the result
+ *
+ * @return  EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR inference_tflite_invoke_features(
+    const ei_impulse_t *impulse,
+    ei_learning_block_config_tflite_graph_t *block_config,
+    ei_eon_model_t *model,
+    uint64_t ctx_start_us,
+    TfLiteTensor *input,
+    TfLiteTensor *outputs,
+    ei_feature_t *fmatrix,
+    uint32_t learn_block_index,
+    uint32_t* input_block_ids,
+    uint32_t input_block_ids_size,
+    ei_impulse_result_t *result,
+    bool debug)
+{
+    auto input_res = fill_input_tensor_from_matrix(fmatrix,
+                                                   result->_raw_outputs,
+                                                   input,
+                                                   input_block_ids,
+                                                   input_block_ids_size,
+                                                   impulse->dsp_blocks_size,
+                                                   impulse->learning_blocks_size);
+
+    if (input_res != EI_IMPULSE_OK) {
+        return input_res;
+    }
+
+    EI_IMPULSE_ERROR run_res = inference_tflite_run(
+        impulse,
+        model,
+        ctx_start_us,
+        &outputs,
+        result, debug);
+
+    EI_IMPULSE_ERROR store_res = inference_tflite_store_outputs(block_config, outputs, learn_block_index, result);
+    if (store_res != EI_IMPULSE_OK) {
+        return store_res;
+    }
+
+    return run_res;
+}
+
+/**
+ * @brief      Do neural network inferencing over a feature matrix
+ *
+ * @param      fmatrix  Processed matrix
+ * @param      result   Output classifier results
+ * @param[in]  debug    Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+EI_IMPULSE_ERROR run_nn_inference(
+    const ei_impulse_t *impulse,
+    ei_feature_t *fmatrix,
+    uint32_t learn_block_index,
+    uint32_t* input_block_ids,
+    uint32_t input_block_ids_size,
+    ei_impulse_result_t *result,
+    void *config_ptr,
+    bool debug = false)
+{
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+
+    TfLiteTensor input;
+    TfLiteTensor *outputs;
+
+    // allocate outputs
+    outputs = (TfLiteTensor*)ei_malloc(block_config->output_tensors_size * sizeof(TfLiteTensor));
+
+    uint64_t ctx_start_us = ei_read_timer_us();
+    ei_eon_model_t model;
+
+    EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+        block_config,
+        &model,
+        &ctx_start_us,
+        &input,
+        &outputs);
+
+    if (init_res != EI_IMPULSE_OK) {
+        return init_res;
+    }
+
+    EI_IMPULSE_ERROR res = inference_tflite_invoke_features(impulse, block_config, &model, ctx_start_us,
+        &input, outputs, fmatrix, learn_block_index, input_block_ids, input_block_ids_size, result, debug);
+
+    eon_model_reset(&model);
     ei_free(outputs);
 
-    if (run_res != EI_IMPULSE_OK) {
-        return run_res;
+    return res;
+}
+
+#if EI_CLASSIFIER_TFLITE_EON_PERSISTENT == 1
+/**
+ * A model set up once and kept between inferences, with its input and output
+ * tensor views
+ */
+typedef struct {
+    ei_eon_model_t model;
+    TfLiteTensor input;
+    TfLiteTensor *outputs;
+} ei_eon_persistent_model_t;
+
+/**
+ * @brief      Whether the model of this learning block can be set up once and
+ *             kept, i.e. whether it has instances (a model with only the one
+ *             global state can't be kept by more than one handle). A model
+ *             built with a static arena has a single instance: its
+ *             init_instance fails while another handle keeps it.
+ */
+static bool can_keep_nn_model(void *config_ptr) {
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+
+    return eon_model_has_instances((ei_config_tflite_eon_graph_t*)block_config->graph_config);
+}
+
+static void free_nn_model(void *model_ptr) {
+    ei_eon_persistent_model_t *model = (ei_eon_persistent_model_t*)model_ptr;
+
+    if (model->model.instance) {
+        eon_model_reset(&model->model);
+    }
+    ei_free(model->outputs);
+    ei_free(model);
+}
+
+/**
+ * @brief      Set up the model of a learning block (arena, init and prepare)
+ *             to be kept and used by run_nn_inference_persistent
+ *
+ * @param      config_ptr  Learning block config
+ * @param      model_ptr   Receives the model, free it with free_nn_model
+ *
+ * @return     The ei impulse error.
+ */
+static EI_IMPULSE_ERROR init_nn_model(void *config_ptr, void **model_ptr) {
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+
+    ei_eon_persistent_model_t *model = (ei_eon_persistent_model_t*)ei_calloc(1, sizeof(ei_eon_persistent_model_t));
+    if (!model) {
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+    model->outputs = (TfLiteTensor*)ei_calloc(block_config->output_tensors_size, sizeof(TfLiteTensor));
+    if (!model->outputs) {
+        ei_free(model);
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+
+    uint64_t ctx_start_us;
+    EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+        block_config,
+        &model->model,
+        &ctx_start_us,
+        &model->input,
+        &model->outputs);
+
+    if (init_res != EI_IMPULSE_OK) {
+        free_nn_model(model);
+        return init_res;
+    }
+
+    *model_ptr = model;
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Do neural network inferencing over a feature matrix with a model
+ *             from init_nn_model, without setting it up again
+ *
+ * @param      model_ptr  Model from init_nn_model
+ *
+ * @return     The ei impulse error.
+ */
+EI_IMPULSE_ERROR run_nn_inference_persistent(
+    const ei_impulse_t *impulse,
+    void *model_ptr,
+    ei_feature_t *fmatrix,
+    uint32_t learn_block_index,
+    uint32_t* input_block_ids,
+    uint32_t input_block_ids_size,
+    ei_impulse_result_t *result,
+    void *config_ptr,
+    bool debug = false)
+{
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+    ei_eon_persistent_model_t *model = (ei_eon_persistent_model_t*)model_ptr;
+
+    return inference_tflite_invoke_features(impulse, block_config, &model->model, ei_read_timer_us(),
+        &model->input, model->outputs, fmatrix, learn_block_index, input_block_ids, input_block_ids_size, result, debug);
+}
+#endif // EI_CLASSIFIER_TFLITE_EON_PERSISTENT == 1
+
+/**
+ * @brief      Whether run_nn_inference_batch can run this learning block
+ *
+ * @param      config_ptr  Learning block config
+ *
+ * @return     true if the compiled model has a batched invoke
+ */
+static bool can_run_nn_inference_batch(void *config_ptr) {
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+
+    bool has_batch = eon_model_has_instances(graph_config) ?
+        graph_config->model_invoke_batch_instance != nullptr :
+        graph_config->model_invoke_batch != nullptr;
+    return has_batch && block_config->output_tensors_size == 1;
+}
+
+/**
+ * @brief      Do neural network inferencing over several feature matrices
+ *             in one invoke, the model sees them as one input with `count` rows
+ *
+ * @param      fmatrices  Processed matrices, one array of DSP block outputs per item
+ * @param      count      Number of items
+ * @param      results    Output classifier results, one per item
+ * @param[in]  debug      Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+EI_IMPULSE_ERROR run_nn_inference_batch(
+    const ei_impulse_t *impulse,
+    ei_feature_t **fmatrices,
+    size_t count,
+    uint32_t learn_block_index,
+    uint32_t* input_block_ids,
+    uint32_t input_block_ids_size,
+    ei_impulse_result_t *results,
+    void *config_ptr,
+    void *model_ptr = nullptr,
+    bool debug = false)
+{
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+
+    if (!can_run_nn_inference_batch(config_ptr)) {
+        return EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE;
+    }
+    if (count == 0) {
+        return EI_IMPULSE_OK;
+    }
+
+    TfLiteTensor input;
+    TfLiteTensor output;
+    TfLiteTensor *outputs = &output;
+
+    uint64_t ctx_start_us = ei_read_timer_us();
+    ei_eon_model_t model;
+
+#if EI_CLASSIFIER_TFLITE_EON_PERSISTENT == 1
+    // a kept model (from init_nn_model) is only borrowed here, never reset
+    ei_eon_persistent_model_t *kept_model = (ei_eon_persistent_model_t*)model_ptr;
+    if (kept_model) {
+        model = kept_model->model;
+        input = kept_model->input;
+        output = kept_model->outputs[0];
+    }
+    else
+#endif
+    {
+        EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+            block_config,
+            &model,
+            &ctx_start_us,
+            &input,
+            &outputs);
+
+        if (init_res != EI_IMPULSE_OK) {
+            return init_res;
+        }
+    }
+
+    auto release_model = [&]() {
+        if (!model_ptr) {
+            eon_model_reset(&model);
+        }
+    };
+
+    // rows of the batched input / output, laid out like the tensors
+    ei_unique_ptr_t p_input_rows(ei_aligned_calloc(16, input.bytes * count), ei_aligned_free);
+    ei_unique_ptr_t p_output_rows(ei_aligned_calloc(16, output.bytes * count), ei_aligned_free);
+    ei_unique_ptr_t p_batch_arena(ei_aligned_calloc(16, graph_config->model_batch_arena_size(count)), ei_aligned_free);
+    if (!p_input_rows || !p_output_rows || !p_batch_arena) {
+        release_model();
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+    uint8_t *input_rows = static_cast<uint8_t*>(p_input_rows.get());
+    uint8_t *output_rows = static_cast<uint8_t*>(p_output_rows.get());
+
+    for (size_t ix = 0; ix < count; ix++) {
+        TfLiteTensor row = input;
+        row.data.data = input_rows + ix * input.bytes;
+
+        auto input_res = fill_input_tensor_from_matrix(fmatrices[ix],
+                                                       results[ix]._raw_outputs,
+                                                       &row,
+                                                       input_block_ids,
+                                                       input_block_ids_size,
+                                                       impulse->dsp_blocks_size,
+                                                       impulse->learning_blocks_size);
+        if (input_res != EI_IMPULSE_OK) {
+            release_model();
+            return input_res;
+        }
+    }
+
+    TfLiteStatus status = eon_model_invoke_batch(
+        &model, count, static_cast<uint8_t*>(p_batch_arena.get()), input_rows, output_rows);
+    release_model();
+    if (status != kTfLiteOk) {
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+
+    // setup and invoke are shared, every item is charged its share
+    uint64_t classification_us = (ei_read_timer_us() - ctx_start_us) / count;
+
+    for (size_t ix = 0; ix < count; ix++) {
+        TfLiteTensor row = output;
+        row.data.data = output_rows + ix * output.bytes;
+
+        EI_IMPULSE_ERROR store_res = inference_tflite_store_outputs(block_config, &row, learn_block_index, &results[ix]);
+        if (store_res != EI_IMPULSE_OK) {
+            return store_res;
+        }
+
+        results[ix].timing.classification_us = classification_us;
+        results[ix].timing.classification = (int)(classification_us / 1000);
+    }
+
+    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+        return EI_IMPULSE_CANCELED;
     }
 
     return EI_IMPULSE_OK;
@@ -320,7 +661,6 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     bool debug = false) {
 
     ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
-    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
 
     uint64_t ctx_start_us;
     TfLiteTensor input;
@@ -329,14 +669,14 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
     // allocate outputs
     outputs = (TfLiteTensor*)ei_malloc(block_config->output_tensors_size * sizeof(TfLiteTensor));
 
-    ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
+    ei_eon_model_t model;
 
     EI_IMPULSE_ERROR init_res = inference_tflite_setup(
         block_config,
+        &model,
         &ctx_start_us,
         &input,
-        &outputs,
-        p_tensor_arena);
+        &outputs);
 
     if (init_res != EI_IMPULSE_OK) {
         return init_res;
@@ -380,10 +720,9 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
 
     EI_IMPULSE_ERROR run_res = inference_tflite_run(
         impulse,
-        block_config,
+        &model,
         ctx_start_us,
         &outputs,
-        static_cast<uint8_t*>(p_tensor_arena.get()),
         result,
         debug);
 
@@ -432,7 +771,7 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
         result->_raw_outputs[learn_block_index + output_ix].blockId = block_config->block_id + output_ix;
     }
 
-    graph_config->model_reset(ei_aligned_free);
+    eon_model_reset(&model);
     ei_free(outputs);
 
     if (run_res != EI_IMPULSE_OK) {
@@ -54,6 +54,15 @@
 #include "edge-impulse-sdk/tensorflow/lite/schema/schema_generated.h"
 #endif // EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE
 
+static inline float normalized_feature(const ei::matrix_t *matrix, const float *mean, const float *scale, size_t ix) {
+    float val = matrix->buffer[ix];
+    if (mean) {
+        val -= mean[ix];
+        val *= scale[ix];
+    }
+    return val;
+}
+
 EI_IMPULSE_ERROR fill_input_tensor_from_matrix(
     ei_feature_t *fmatrix,
     ei_feature_t *omatrix,
@@ -70,29 +79,37 @@ EI_IMPULSE_ERROR fill_input_tensor_from_matrix(
 #if EI_CLASSIFIER_SINGLE_FEATURE_INPUT == 0
         size_t cur_mtx = input_block_ids[i];
         ei::matrix_t* matrix = NULL;
+        ei_feature_t* feature = NULL;
 
-        if (!find_mtx_by_idx(fmatrix, &matrix, cur_mtx, fmtx_size)) {
-            if (!find_mtx_by_idx(omatrix, &matrix, cur_mtx, omtx_size)) {
-                ei_printf("ERR: Cannot find matrix with id %zu\n", cur_mtx);
-                return EI_IMPULSE_INVALID_SIZE;
-            }
+        if (find_feature_by_idx(fmatrix, &feature, cur_mtx, fmtx_size)) {
+            matrix = feature->matrix;
+        }
+        else if (!find_mtx_by_idx(omatrix, &matrix, cur_mtx, omtx_size)) {
+            ei_printf("ERR: Cannot find matrix with id %zu\n", cur_mtx);
+            return EI_IMPULSE_INVALID_SIZE;
         }
 #else
-        ei::matrix_t* matrix = fmatrix[0].matrix;
+        ei_feature_t* feature = &fmatrix[0];
+        ei::matrix_t* matrix = feature->matrix;
 #endif
 
         matrix_els += matrix->rows * matrix->cols;
 
+        // a standard scaler left for us by process_impulse is applied on the
+        // way in, same float ops (and so the same values) as running it first
+        const float *mean = feature ? feature->pending_mean : nullptr;
+        const float *scale = feature ? feature->pending_scale : nullptr;
+
         switch (input->type) {
             case kTfLiteFloat32: {
                 for (size_t ix = 0; ix < matrix->rows * matrix->cols; ix++) {
-                    input->data.f[input_idx++] = matrix->buffer[ix];
+                    input->data.f[input_idx++] = normalized_feature(matrix, mean, scale, ix);
                 }
                 break;
             }
             case kTfLiteInt8: {
                 for (size_t ix = 0; ix < matrix->rows * matrix->cols; ix++) {
-                    float val = (float)matrix->buffer[ix];
+                    float val = normalized_feature(matrix, mean, scale, ix);
                     input->data.int8[input_idx++] = static_cast<int8_t>(
                         pre_cast_quantize(val, input->params.scale, input->params.zero_point, true));
                 }
@@ -100,7 +117,7 @@ EI_IMPULSE_ERROR fill_input_tensor_from_matrix(
             }
             case kTfLiteUInt8: {
                 for (size_t ix = 0; ix < matrix->rows * matrix->cols; ix++) {
-                    float val = (float)matrix->buffer[ix];
+                    float val = normalized_feature(matrix, mean, scale, ix);
                     input->data.uint8[input_idx++] = static_cast<uint8_t>(
                         pre_cast_quantize(val, input->params.scale, input->params.zero_point, false));            }
                 break;
@@ -102,6 +102,30 @@
 #define EIDSP_SIGNAL_C_FN_POINTER    0
 #endif // EIDSP_SIGNAL_C_FN_POINTER
 
+// Keep a kissfft plan plus scratch per FFT size (per thread) rather than
+// allocating them on every rfft() call. Needs thread_local, so it's only on
+// by default on hosted targets.
+#ifndef EIDSP_FFT_PLAN_CACHE
+#if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+#define EIDSP_FFT_PLAN_CACHE    1
+#else
+#define EIDSP_FFT_PLAN_CACHE    0
+#endif
+#endif // EIDSP_FFT_PLAN_CACHE
+
+// Spectrogram frames go through numpy::power_spectrum_batch(), 8 at a time
+// across SIMD lanes (AVX2 when the CPU has it). x86-64 hosts with GCC / clang
+// only, everything else takes one frame at a time through rfft(). Off on
+// Windows: Win64 GCC doesn't keep the stack 32-byte aligned, so spilled __m256
+// locals can fault (GCC PR 54412).
+#ifndef EIDSP_BATCH_RFFT
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(_WIN32)
+#define EIDSP_BATCH_RFFT        1
+#else
+#define EIDSP_BATCH_RFFT        0
+#endif
+#endif // EIDSP_BATCH_RFFT
+
 #ifndef EIDSP_USE_ESP_DSP
 #if defined(ESP32) || defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_IDF_TARGET_ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32P4) || defined(CONFIG_IDF_TARGET_ESP32C3)
 #define EIDSP_USE_ESP_DSP 1
@@ -62,6 +62,14 @@ public:
         const float frequency,
         ei_impulse_result_t *result) = 0; // result* is a hack.  I want to pass full context everywhere but custom DSP. TODO
 
+    /**
+     * @brief Override and return false if the state is only a cache, i.e. the output never depends on
+     * earlier calls, so there is nothing for run_classifier_init() to reset
+     *
+     * @return bool
+     */
+    virtual bool keeps_state() { return true; }
+
     // Must declare so user can override
     /**
      * @brief If you call new or ei_malloc anywhere in your class, you must override this function and delete your objects
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Generated by Edge Impulse and licensed under the applicable Edge Impulse
+ * Terms of Service. Community and Professional Terms of Service
+ * (https://edgeimpulse.com/legal/terms-of-service) or Enterprise Terms of
+ * Service (https://edgeimpulse.com/legal/enterprise-terms-of-service),
+ * according to your product plan subscription (the “License”).
+ *
+ * This software, documentation and other associated files (collectively referred
+ * to as the “Software”) is a single SDK variation generated by the Edge Impulse
+ * platform and requires an active paid Edge Impulse subscription to use this
+ * Software for any purpose.
+ *
+ * You may NOT use this Software unless you have an active Edge Impulse subscription
+ * that meets the eligibility requirements for the applicable License, subject to
+ * your full and continued compliance with the terms and conditions of the License,
+ * including without limitation any usage restrictions under the applicable License.
+ *
+ * If you do not have an active Edge Impulse product plan subscription, or if use
+ * of this Software exceeds the usage limitations of your Edge Impulse product plan
+ * subscription, you are not permitted to use this Software and must immediately
+ * delete and erase all copies of this Software within your control or possession.
+ * Edge Impulse reserves all rights and remedies available to enforce its rights.
+ *
+ * Unless required by applicable law or agreed to in writing, the Software is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing
+ * permissions, disclaimers and limitations under the License.
+ */
+#ifndef __EI_FFT_PLAN__H__
+#define __EI_FFT_PLAN__H__
+
+#include <stddef.h>
+#include "edge-impulse-sdk/dsp/config.hpp"
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+#include "edge-impulse-sdk/dsp/kissfft/kiss_fftr.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+#if EIDSP_FFT_PLAN_CACHE
+
+namespace ei {
+
+/**
+ * Everything a real FFT of one size needs: the kissfft configuration and
+ * scratch for the zero padded input and the complex output.
+ */
+struct fft_plan_t {
+    size_t n_fft;
+    kiss_fftr_cfg cfg;          // nullptr when kissfft isn't compiled in
+    float *input;               // n_fft
+    fft_complex_t *output;      // n_fft / 2 + 1
+};
+
+/**
+ * Plans by FFT size, made on first use and kept for the life of the thread,
+ * so rfft() / power_spectrum() don't allocate once they've seen a size.
+ * One cache per thread, the scratch is written on every call.
+ */
+class fft_plan_cache {
+public:
+    static const size_t MAX_PLANS = 8;
+
+    /**
+     * Plan for n_fft, made if we haven't seen the size yet. Call up front
+     * (e.g. when a DSP block is set up) to keep the allocation out of the
+     * first inference.
+     * @returns nullptr if out of memory, or too many different sizes
+     */
+    static fft_plan_t *get(size_t n_fft) {
+        return instance().find_or_create(n_fft);
+    }
+
+    ~fft_plan_cache() {
+        for (size_t ix = 0; ix < count_; ix++) {
+            destroy(&plans_[ix]);
+        }
+    }
+
+private:
+    fft_plan_cache() : count_(0) { }
+
+    static fft_plan_cache &instance() {
+        static thread_local fft_plan_cache cache;
+        return cache;
+    }
+
+    fft_plan_t *find_or_create(size_t n_fft) {
+        for (size_t ix = 0; ix < count_; ix++) {
+            if (plans_[ix].n_fft == n_fft) {
+                return &plans_[ix];
+            }
+        }
+        if (count_ == MAX_PLANS) {
+            return nullptr;
+        }
+
+        fft_plan_t *plan = &plans_[count_];
+        plan->n_fft = n_fft;
+        plan->cfg = nullptr;
+        plan->input = (float *)ei_calloc(n_fft, sizeof(float));
+        plan->output = (fft_complex_t *)ei_calloc(n_fft / 2 + 1, sizeof(fft_complex_t));
+#if EIDSP_INCLUDE_KISSFFT || !defined(EIDSP_INCLUDE_KISSFFT)
+        size_t kiss_fftr_mem_length;
+        plan->cfg = kiss_fftr_alloc(n_fft, 0, NULL, NULL, &kiss_fftr_mem_length);
+        if (!plan->cfg) {
+            destroy(plan);
+            return nullptr;
+        }
+#endif
+        if (!plan->input || !plan->output) {
+            destroy(plan);
+            return nullptr;
+        }
+        count_++;
+        return plan;
+    }
+
+    static void destroy(fft_plan_t *plan) {
+        if (plan->cfg) {
+            KISS_FFT_FREE(plan->cfg);
+        }
+        if (plan->input) {
+            ei_free(plan->input);
+        }
+        if (plan->output) {
+            ei_free(plan->output);
+        }
+        plan->cfg = nullptr;
+        plan->input = nullptr;
+        plan->output = nullptr;
+    }
+
+    fft_plan_t plans_[MAX_PLANS];
+    size_t count_;
+};
+
+} // namespace ei
+
+#endif // EIDSP_FFT_PLAN_CACHE
+
+#endif // __EI_FFT_PLAN__H__
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Generated by Edge Impulse and licensed under the applicable Edge Impulse
+ * Terms of Service. Community and Professional Terms of Service
+ * (https://edgeimpulse.com/legal/terms-of-service) or Enterprise Terms of
+ * Service (https://edgeimpulse.com/legal/enterprise-terms-of-service),
+ * according to your product plan subscription (the “License”).
+ *
+ * This software, documentation and other associated files (collectively referred
+ * to as the “Software”) is a single SDK variation generated by the Edge Impulse
+ * platform and requires an active paid Edge Impulse subscription to use this
+ * Software for any purpose.
+ *
+ * You may NOT use this Software unless you have an active Edge Impulse subscription
+ * that meets the eligibility requirements for the applicable License, subject to
+ * your full and continued compliance with the terms and conditions of the License,
+ * including without limitation any usage restrictions under the applicable License.
+ *
+ * If you do not have an active Edge Impulse product plan subscription, or if use
+ * of this Software exceeds the usage limitations of your Edge Impulse product plan
+ * subscription, you are not permitted to use this Software and must immediately
+ * delete and erase all copies of this Software within your control or possession.
+ * Edge Impulse reserves all rights and remedies available to enforce its rights.
+ *
+ * Unless required by applicable law or agreed to in writing, the Software is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing
+ * permissions, disclaimers and limitations under the License.
+ */
+#ifndef __EI_RFFT_BATCH__H__
+#define __EI_RFFT_BATCH__H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "edge-impulse-sdk/dsp/config.hpp"
+
+#if EIDSP_BATCH_RFFT
+
+namespace ei {
+namespace rfft_batch {
+
+/**
+ * Power spectrum of up to 8 frames at once, one frame per SIMD lane, for the
+ * power of two FFT sizes the spectrogram uses. Radix-2 decimation in time on
+ * GCC vector types: built once for AVX2 and once for the baseline ISA, and
+ * picked at run time.
+ *
+ * Numerically this is a different FFT than kissfft and the power is taken
+ * from re^2 + im^2 directly, so values differ from numpy::power_spectrum in
+ * the last bit or so.
+ */
+
+typedef float v8f __attribute__((vector_size(32)));
+
+static const size_t LANES = 8;
+
+template<size_t N>
+struct tables_t {
+    float w_re[N / 2];          // exp(-2 pi i k / N)
+    float w_im[N / 2];
+    uint16_t bitrev[N];
+
+    tables_t() {
+        for (size_t k = 0; k < N / 2; k++) {
+            const double phase = -2.0 * M_PI * (double)k / (double)N;
+            w_re[k] = (float)cos(phase);
+            w_im[k] = (float)sin(phase);
+        }
+        size_t bits = 0;
+        while (((size_t)1 << bits) < N) {
+            bits++;
+        }
+        for (size_t i = 0; i < N; i++) {
+            size_t r = 0;
+            for (size_t b = 0; b < bits; b++) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            bitrev[i] = (uint16_t)r;
+        }
+    }
+};
+
+template<size_t N>
+static const tables_t<N> &tables() {
+    static const tables_t<N> t;
+    return t;
+}
+
+/**
+ * The kernel, inlined into one function per ISA below. n_frames <= 8, frame
+ * f starts at frames + f * frame_stride and is cut / zero padded to N.
+ * Writes N / 2 + 1 bins per frame to out (rows out_stride apart), with
+ * zeros replaced by 1e-10 like numpy::zero_handling.
+ */
+template<size_t N>
+static inline __attribute__((always_inline)) void power_spectrum_x8(
+    const tables_t<N> &t,
+    const float *frames,
+    size_t n_frames,
+    size_t frame_stride,
+    size_t frame_size,
+    float *out,
+    size_t out_stride)
+{
+    v8f re[N];
+    v8f im[N];
+
+    // load one frame per lane, in bit reversed order
+    const size_t n_in = frame_size < N ? frame_size : N;
+    for (size_t i = 0; i < N; i++) {
+        const size_t src = t.bitrev[i];
+        v8f v = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        if (src < n_in) {
+            for (size_t lane = 0; lane < n_frames; lane++) {
+                v[lane] = frames[lane * frame_stride + src];
+            }
+        }
+        re[i] = v;
+    }
+
+    // first stage, the input is real and the twiddle is 1
+    for (size_t j = 0; j < N; j += 2) {
+        const v8f a = re[j];
+        const v8f b = re[j + 1];
+        re[j] = a + b;
+        re[j + 1] = a - b;
+        im[j] = v8f { 0, 0, 0, 0, 0, 0, 0, 0 };
+        im[j + 1] = im[j];
+    }
+
+    for (size_t m = 4; m < N; m <<= 1) {
+        const size_t half = m / 2;
+        const size_t step = N / m;
+        for (size_t j = 0; j < N; j += m) {
+            for (size_t k = 0; k < half; k++) {
+                const float wr = t.w_re[k * step];
+                const float wi = t.w_im[k * step];
+                const v8f xr = re[j + k + half];
+                const v8f xi = im[j + k + half];
+                const v8f tr = xr * wr - xi * wi;
+                const v8f ti = xr * wi + xi * wr;
+                re[j + k + half] = re[j + k] - tr;
+                im[j + k + half] = im[j + k] - ti;
+                re[j + k] = re[j + k] + tr;
+                im[j + k] = im[j + k] + ti;
+            }
+        }
+    }
+
+    // last stage, only bins 0 .. N / 2 are needed, fused with |X|^2 / N
+    const float scale = 1.0f / (float)N;
+    v8f power[N / 2 + 1];
+    for (size_t k = 0; k < N / 2; k++) {
+        const float wr = t.w_re[k];
+        const float wi = t.w_im[k];
+        const v8f xr = re[k + N / 2];
+        const v8f xi = im[k + N / 2];
+        const v8f tr = xr * wr - xi * wi;
+        const v8f ti = xr * wi + xi * wr;
+        const v8f yr = re[k] + tr;
+        const v8f yi = im[k] + ti;
+        power[k] = (yr * yr + yi * yi) * scale;
+    }
+    {
+        const v8f yr = re[0] - re[N / 2];
+        const v8f yi = im[0] - im[N / 2];
+        power[N / 2] = (yr * yr + yi * yi) * scale;
+    }
+
+    for (size_t lane = 0; lane < n_frames; lane++) {
+        float *row = out + lane * out_stride;
+        for (size_t k = 0; k <= N / 2; k++) {
+            const float v = power[k][lane];
+            row[k] = v == 0.0f ? 1e-10f : v;
+        }
+    }
+}
+
+template<size_t N>
+static void power_spectrum_default(const float *frames, size_t n_frames, size_t frame_stride,
+                                   size_t frame_size, float *out, size_t out_stride)
+{
+    const tables_t<N> &t = tables<N>();
+    for (size_t f = 0; f < n_frames; f += LANES) {
+        const size_t n = n_frames - f < LANES ? n_frames - f : LANES;
+        power_spectrum_x8<N>(t, frames + f * frame_stride, n, frame_stride, frame_size,
+                             out + f * out_stride, out_stride);
+    }
+}
+
+template<size_t N>
+__attribute__((target("avx2")))
+static void power_spectrum_avx2(const float *frames, size_t n_frames, size_t frame_stride,
+                                size_t frame_size, float *out, size_t out_stride)
+{
+    const tables_t<N> &t = tables<N>();
+    for (size_t f = 0; f < n_frames; f += LANES) {
+        const size_t n = n_frames - f < LANES ? n_frames - f : LANES;
+        power_spectrum_x8<N>(t, frames + f * frame_stride, n, frame_stride, frame_size,
+                             out + f * out_stride, out_stride);
+    }
+}
+
+static inline bool has_avx2() {
+    static const bool avx2 = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return avx2;
+}
+
+template<size_t N>
+static void power_spectrum_n(const float *frames, size_t n_frames, size_t frame_stride,
+                             size_t frame_size, float *out, size_t out_stride)
+{
+    if (has_avx2()) {
+        power_spectrum_avx2<N>(frames, n_frames, frame_stride, frame_size, out, out_stride);
+    }
+    else {
+        power_spectrum_default<N>(frames, n_frames, frame_stride, frame_size, out, out_stride);
+    }
+}
+
+/**
+ * Power spectrum of n_frames frames of fft_points.
+ * @returns false if fft_points isn't a size we have a kernel for, the
+ * caller goes frame by frame then
+ */
+static inline bool power_spectrum(const float *frames, size_t n_frames, size_t frame_stride,
+                                  size_t frame_size, float *out, size_t out_stride,
+                                  size_t fft_points)
+{
+    switch (fft_points) {
+        case 16: power_spectrum_n<16>(frames, n_frames, frame_stride, frame_size, out, out_stride); return true;
+        case 32: power_spectrum_n<32>(frames, n_frames, frame_stride, frame_size, out, out_stride); return true;
+        case 64: power_spectrum_n<64>(frames, n_frames, frame_stride, frame_size, out, out_stride); return true;
+        case 128: power_spectrum_n<128>(frames, n_frames, frame_stride, frame_size, out, out_stride); return true;
+        case 256: power_spectrum_n<256>(frames, n_frames, frame_stride, frame_size, out, out_stride); return true;
+        default: return false;
+    }
+}
+
+} // namespace rfft_batch
+} // namespace ei
+
+#endif // EIDSP_BATCH_RFFT
+
+#endif // __EI_RFFT_BATCH__H__
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Generated by Edge Impulse and licensed under the applicable Edge Impulse
+ * Terms of Service. Community and Professional Terms of Service
+ * (https://edgeimpulse.com/legal/terms-of-service) or Enterprise Terms of
+ * Service (https://edgeimpulse.com/legal/enterprise-terms-of-service),
+ * according to your product plan subscription (the “License”).
+ *
+ * This software, documentation and other associated files (collectively referred
+ * to as the “Software”) is a single SDK variation generated by the Edge Impulse
+ * platform and requires an active paid Edge Impulse subscription to use this
+ * Software for any purpose.
+ *
+ * You may NOT use this Software unless you have an active Edge Impulse subscription
+ * that meets the eligibility requirements for the applicable License, subject to
+ * your full and continued compliance with the terms and conditions of the License,
+ * including without limitation any usage restrictions under the applicable License.
+ *
+ * If you do not have an active Edge Impulse product plan subscription, or if use
+ * of this Software exceeds the usage limitations of your Edge Impulse product plan
+ * subscription, you are not permitted to use this Software and must immediately
+ * delete and erase all copies of this Software within your control or possession.
+ * Edge Impulse reserves all rights and remedies available to enforce its rights.
+ *
+ * Unless required by applicable law or agreed to in writing, the Software is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing
+ * permissions, disclaimers and limitations under the License.
+ */
+#ifndef __EI_SPECTRAL_ANALYSIS__H__
+#define __EI_SPECTRAL_ANALYSIS__H__
+
+#include <string.h>
+#include "edge-impulse-sdk/dsp/ei_vector.h"
+#include "edge-impulse-sdk/dsp/returntypes.hpp"
+#include "edge-impulse-sdk/dsp/ei_dsp_handle.h"
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/dsp/numpy.hpp"
+#include "edge-impulse-sdk/dsp/spectral/wavelet.hpp"
+
+// Included at the end of ei_run_dsp.h: everything but Wavelet goes to the
+// stateless extract_spectral_analysis_features() defined there.
+
+/**
+ * Spectral analysis block with its scratch kept between windows. In Wavelet
+ * mode the wavelet filters are looked up once when the block is created and
+ * the input copy, the DWT levels and the feature vector live in a workspace
+ * owned by the handle, so a window doesn't allocate. Other analysis types go
+ * to the stateless extract_spectral_analysis_features().
+ */
+class spectral_analysis_class : public DspHandle {
+public:
+    int print() override {
+        ei_printf("spectral analysis: wavelet %s, filter length %d\n",
+            is_wavelet ? "yes" : "no", is_wavelet ? (int)bank.size : 0);
+        return ei::EIDSP_OK;
+    }
+
+    bool keeps_state() override {
+        return false;
+    }
+
+    int extract(
+        ei::signal_t *signal,
+        ei::matrix_t *output_matrix,
+        void *config_ptr,
+        const float frequency,
+        ei_impulse_result_t *result) override
+    {
+        using namespace ei;
+
+        ei_dsp_config_spectral_analysis_t *config = (ei_dsp_config_spectral_analysis_t *)config_ptr;
+
+        if (!is_wavelet) {
+            return extract_spectral_analysis_features(signal, output_matrix, config_ptr, frequency);
+        }
+
+        // input matrix from the raw signal
+        input.resize(signal->total_length);
+        matrix_t input_matrix(signal->total_length / config->axes, config->axes, input.data());
+
+        int ret = signal->get_data(0, signal->total_length, input_matrix.buffer);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        return spectral::wavelet::extract_wavelet_features(&input_matrix, output_matrix, config,
+            frequency, bank, &ws);
+    }
+
+    static DspHandle* create(void* config, float frequency);
+
+    void* operator new(size_t size) {
+        return ei_malloc(size);
+    }
+
+    void operator delete(void* ptr) {
+        ei_free(ptr);
+    }
+
+private:
+    bool is_wavelet;
+    spectral::wavelet::filter_bank bank;
+    spectral::wavelet::workspace ws;
+    ei_vector<float> input;
+
+    spectral_analysis_class(ei_dsp_config_spectral_analysis_t *config) {
+        is_wavelet = strcmp(config->analysis_type, "Wavelet") == 0 &&
+            spectral::wavelet::find_filter_bank(config->wavelet, &bank);
+    }
+};
+
+DspHandle* spectral_analysis_class::create(void* config, float frequency) { // NOLINT def in header is OK at EI
+    return new spectral_analysis_class((ei_dsp_config_spectral_analysis_t *)config);
+};
+
+#endif  //!__EI_SPECTRAL_ANALYSIS__H__
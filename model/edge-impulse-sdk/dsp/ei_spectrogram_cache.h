@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Generated by Edge Impulse and licensed under the applicable Edge Impulse
+ * Terms of Service. Community and Professional Terms of Service
+ * (https://edgeimpulse.com/legal/terms-of-service) or Enterprise Terms of
+ * Service (https://edgeimpulse.com/legal/enterprise-terms-of-service),
+ * according to your product plan subscription (the “License”).
+ *
+ * This software, documentation and other associated files (collectively referred
+ * to as the “Software”) is a single SDK variation generated by the Edge Impulse
+ * platform and requires an active paid Edge Impulse subscription to use this
+ * Software for any purpose.
+ *
+ * You may NOT use this Software unless you have an active Edge Impulse subscription
+ * that meets the eligibility requirements for the applicable License, subject to
+ * your full and continued compliance with the terms and conditions of the License,
+ * including without limitation any usage restrictions under the applicable License.
+ *
+ * If you do not have an active Edge Impulse product plan subscription, or if use
+ * of this Software exceeds the usage limitations of your Edge Impulse product plan
+ * subscription, you are not permitted to use this Software and must immediately
+ * delete and erase all copies of this Software within your control or possession.
+ * Edge Impulse reserves all rights and remedies available to enforce its rights.
+ *
+ * Unless required by applicable law or agreed to in writing, the Software is
+ * distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing
+ * permissions, disclaimers and limitations under the License.
+ */
+#ifndef __EI_SPECTROGRAM_CACHE__H__
+#define __EI_SPECTROGRAM_CACHE__H__
+
+#include <string.h>
+#include "edge-impulse-sdk/dsp/ei_vector.h"
+#include "edge-impulse-sdk/dsp/returntypes.hpp"
+#include "edge-impulse-sdk/dsp/ei_dsp_handle.h"
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/dsp/numpy.hpp"
+#include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
+
+// Number of interleaved streams one handle keeps frames for (see below)
+#ifndef EI_SPECTROGRAM_CACHE_TRACKS
+#define EI_SPECTROGRAM_CACHE_TRACKS     8
+#endif
+
+/**
+ * Stateful spectrogram block. Keeps the power spectrum of every frame of the
+ * previous window in a ring indexed by absolute frame number (absolute start
+ * sample / frame stride), so when the window has slid by a multiple of the
+ * frame stride only the frames that are new since the last call go through
+ * numpy::power_spectrum_batch(). The slide is found by comparing the new
+ * window with the previous one, so a frame is only ever reused when its raw
+ * samples are identical, and the output is the same as
+ * extract_spectrogram_features().
+ *
+ * One handle may see windows of several streams interleaved (a worker under
+ * --streams, the --ws connections), so it keeps up to
+ * EI_SPECTROGRAM_CACHE_TRACKS "tracks", each with its own previous window and
+ * frames. A window continues whichever track it slid on from; a window that
+ * continues none takes over the least recently used track. With more streams
+ * than tracks nothing gets reused, but the output is still exact.
+ */
+class spectrogram_cache_class : public DspHandle {
+public:
+    int print() override {
+        ei_printf("spectrogram cache: %d frames of %d, stride %d, %d tracks\n",
+            (int)frame_count, (int)frame_length, (int)frame_stride,
+            (int)EI_SPECTROGRAM_CACHE_TRACKS);
+        return ei::EIDSP_OK;
+    }
+
+    bool keeps_state() override {
+        return false;
+    }
+
+    int extract(
+        ei::signal_t *signal,
+        ei::matrix_t *output_matrix,
+        void *config_ptr,
+        const float frequency,
+        ei_impulse_result_t *result) override
+    {
+        using namespace ei;
+
+        ei_dsp_config_spectrogram_t *config = (ei_dsp_config_spectrogram_t *)config_ptr;
+
+        if (config->axes != 1) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        if (signal->total_length == 0) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        matrix_size_t out_matrix_size =
+            speechpy::feature::calculate_mfe_buffer_size(
+                signal->total_length, (uint32_t)frequency, config->frame_length, config->frame_stride,
+                config->fft_length / 2 + 1, config->implementation_version);
+        if (out_matrix_size.rows * out_matrix_size.cols > output_matrix->rows * output_matrix->cols) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+        output_matrix->rows = out_matrix_size.rows;
+        output_matrix->cols = out_matrix_size.cols;
+
+        if (signal->total_length != window_size) {
+            int ret = layout(signal, config, frequency);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+        }
+
+        if (frame_count != output_matrix->rows || coefficients != output_matrix->cols) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        float *window = incoming.data();
+        int ret = signal->get_data(0, window_size, window);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        // the track this window continues and how many frames it slid by,
+        // frame_count if it continues none
+        track_t *track = nullptr;
+        size_t slide = frame_count;
+        for (size_t t = 0; t < EI_SPECTROGRAM_CACHE_TRACKS && !track; t++) {
+            if (tracks[t].last_used == 0) {
+                continue;
+            }
+            const float *prev_window = tracks[t].window.data();
+            for (size_t k = 0; k < frame_count; k++) {
+                const size_t shift = k * frame_stride;
+                if (memcmp(window, prev_window + shift, (window_size - shift) * sizeof(float)) == 0) {
+                    track = &tracks[t];
+                    slide = k;
+                    break;
+                }
+            }
+        }
+        if (!track) {
+            track = &tracks[0];
+            for (size_t t = 1; t < EI_SPECTROGRAM_CACHE_TRACKS; t++) {
+                if (tracks[t].last_used < track->last_used) {
+                    track = &tracks[t];
+                }
+            }
+        }
+        // left empty unless the frames below all come out
+        track->last_used = 0;
+        track->first_frame += slide;
+
+        const uint64_t first_frame = track->first_frame;
+        float *spectra = track->spectra.data();
+
+        // frames still there from the previous window, the rest are new
+        const size_t kept = slide < frame_count ? frame_count - slide : 0;
+        for (size_t ix = 0; ix < kept; ix++) {
+            const float *row = spectra + ((first_frame + ix) % frame_count) * coefficients;
+            memcpy(output_matrix->buffer + ix * coefficients, row, coefficients * sizeof(float));
+        }
+
+        for (size_t ix = kept; ix < frame_count; ix++) {
+            float *frame = frames.data() + (ix - kept) * frame_length;
+            memcpy(frame, window + ix * frame_stride, frame_length * sizeof(float));
+
+            // same per-frame scaling as speechpy::feature::spectrogram
+            if (config->implementation_version == 3) {
+                bool all_between_min_1_and_1 = true;
+                for (size_t jx = 0; jx < frame_length; jx++) {
+                    if (frame[jx] < -1.0f || frame[jx] > 1.0f) {
+                        all_between_min_1_and_1 = false;
+                        break;
+                    }
+                }
+                if (!all_between_min_1_and_1) {
+                    matrix_t frame_matrix(1, frame_length, frame);
+                    ret = numpy::scale(&frame_matrix, 1.0f / 32768.0f);
+                    if (ret != EIDSP_OK) {
+                        EIDSP_ERR(ret);
+                    }
+                }
+            }
+        }
+
+        // all new frames in one go, straight into the output (zero handling included)
+        if (kept < frame_count) {
+            float *new_rows = output_matrix->buffer + kept * coefficients;
+            ret = numpy::power_spectrum_batch(frames.data(), frame_count - kept, frame_length,
+                frame_length, new_rows, coefficients, config->fft_length);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+            for (size_t ix = kept; ix < frame_count; ix++) {
+                float *row = spectra + ((first_frame + ix) % frame_count) * coefficients;
+                memcpy(row, output_matrix->buffer + ix * coefficients, coefficients * sizeof(float));
+            }
+        }
+
+        track->window.swap(incoming);
+        track->last_used = ++calls;
+
+        if (config->implementation_version < 3) {
+            ret = numpy::normalize(output_matrix);
+        }
+        else {
+            ret = speechpy::processing::spectrogram_normalization(output_matrix,
+                config->noise_floor_db, config->implementation_version == 3);
+        }
+        if (ret != EIDSP_OK) {
+            ei_printf("ERR: normalization failed (%d)\n", ret);
+            EIDSP_ERR(ret);
+        }
+
+        output_matrix->cols = out_matrix_size.rows * out_matrix_size.cols;
+        output_matrix->rows = 1;
+
+        // the stateless block's stack_frames() trims the caller's signal to the
+        // samples its frames cover and later blocks see that length, keep that
+        signal->total_length = frames_length;
+
+        return EIDSP_OK;
+    }
+
+    static DspHandle* create(void* config, float frequency);
+
+    void* operator new(size_t size) {
+        return ei_malloc(size);
+    }
+
+    void operator delete(void* ptr) {
+        ei_free(ptr);
+    }
+
+private:
+    size_t window_size = 0;
+    size_t frames_length = 0;       // samples covered by the frames
+    size_t frame_count = 0;
+    size_t frame_length = 0;
+    size_t frame_stride = 0;
+    size_t coefficients = 0;
+
+    struct track_t {
+        ei_vector<float> window;    // the last window of this track
+        ei_vector<float> spectra;   // frame_count rows, row of frame f at f % frame_count
+        uint64_t first_frame = 0;   // absolute frame number of the window's first frame
+        uint64_t last_used = 0;     // value of calls when last used, 0 if empty
+    };
+
+    track_t tracks[EI_SPECTROGRAM_CACHE_TRACKS];
+    uint64_t calls = 0;
+    ei_vector<float> incoming;      // the window being processed
+    ei_vector<float> frames;        // the new frames of a window, frame_length apart
+
+    spectrogram_cache_class() = default;
+
+    // Frame positions for this window size, from the same stack_frames() the
+    // stateless block uses. Drops whatever was cached.
+    int layout(ei::signal_t *signal, ei_dsp_config_spectrogram_t *config, float frequency) {
+        using namespace ei;
+
+        // stack_frames() trims total_length, extract() applies that at the end
+        signal_t frames_signal = *signal;
+        speechpy::stack_frames_info_t info;
+        info.signal = &frames_signal;
+        int ret = speechpy::processing::stack_frames(&info, frequency, config->frame_length,
+            config->frame_stride, false, config->implementation_version);
+        if (ret != EIDSP_OK) {
+            return ret;
+        }
+
+        window_size = signal->total_length;
+        frames_length = frames_signal.total_length;
+        frame_count = info.frame_ixs.size();
+        frame_length = info.frame_length;
+        frame_stride = frame_count > 1 ? info.frame_ixs[1] - info.frame_ixs[0] : frame_length;
+        coefficients = config->fft_length / 2 + 1;
+
+        for (size_t ix = 0; ix < frame_count; ix++) {
+            if (info.frame_ixs[ix] != ix * frame_stride ||
+                info.frame_ixs[ix] + frame_length > window_size) {
+                return EIDSP_PARAMETER_INVALID;
+            }
+        }
+
+        for (size_t t = 0; t < EI_SPECTROGRAM_CACHE_TRACKS; t++) {
+            tracks[t].window.assign(window_size, 0.0f);
+            tracks[t].spectra.assign(frame_count * coefficients, 0.0f);
+            tracks[t].first_frame = 0;
+            tracks[t].last_used = 0;
+        }
+        incoming.assign(window_size, 0.0f);
+        frames.assign(frame_count * frame_length, 0.0f);
+        calls = 0;
+        return EIDSP_OK;
+    }
+};
+
+DspHandle* spectrogram_cache_class::create(void* config, float frequency) { // NOLINT def in header is OK at EI
+#if EIDSP_FFT_PLAN_CACHE
+    // set up the FFT now rather than in the first window
+    ei::fft_plan_cache::get(((ei_dsp_config_spectrogram_t *)config)->fft_length);
+#endif
+    return new spectrogram_cache_class();
+};
+
+#endif  //!__EI_SPECTROGRAM_CACHE__H__
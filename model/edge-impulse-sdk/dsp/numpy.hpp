@@ -93,6 +93,9 @@
 
 #endif // EIDSP_INCLUDE_KISSFFT
 
+#include "ei_fft_plan.h"
+#include "ei_rfft_batch.h"
+
 // For the following CMSIS includes, we want to use the C fallback, so include whether or not we set the CMSIS flag
 #include "edge-impulse-sdk/CMSIS/DSP/Include/dsp/statistics_functions.h"
 
@@ -1318,9 +1321,15 @@ public:
             EIDSP_ERR(EIDSP_BUFFER_SIZE_MISMATCH);
         }
 
+#if EIDSP_FFT_PLAN_CACHE
+        fft_plan_t *plan = fft_plan_cache::get(n_fft);
+        EI_ERR_AND_RETURN_ON_NULL(plan, EIDSP_OUT_OF_MEM);
+        fft_complex_t *fft_output = plan->output;
+#else
         fft_complex_t *fft_output = NULL;
         auto ptr = EI_MAKE_TRACKED_POINTER(fft_output, n_fft_out_features);
         EI_ERR_AND_RETURN_ON_NULL(fft_output, EIDSP_OUT_OF_MEM);
+#endif
 
         int ret = rfft(src, src_size, fft_output, n_fft_out_features, n_fft);
         if (ret != EIDSP_OK) {
@@ -1358,21 +1367,30 @@ public:
 
         // Unfortunately, arm fft (at least) modifies the input buffer AND does not work in place
         // So we have to copy the input to a new buffer
-        EI_DSP_MATRIX(fft_input, 1, n_fft);
-        if (!fft_input.buffer) {
+#if EIDSP_FFT_PLAN_CACHE
+        fft_plan_t *plan = fft_plan_cache::get(n_fft);
+        if (!plan) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        float *fft_input = plan->input;
+#else
+        EI_DSP_MATRIX(fft_input_matrix, 1, n_fft);
+        if (!fft_input_matrix.buffer) {
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
+        float *fft_input = fft_input_matrix.buffer;
+#endif
 
         // If the buffer wasn't assigned to source above, let's copy and pad
         // copy from src to fft_input
-        memcpy(fft_input.buffer, src, src_size * sizeof(float));
+        memcpy(fft_input, src, src_size * sizeof(float));
         // pad to the rigth with zeros
-        memset(fft_input.buffer + src_size, 0, (n_fft - src_size) * sizeof(float));
+        memset(fft_input + src_size, 0, (n_fft - src_size) * sizeof(float));
 
-        auto res = ei::fft::hw_r2c_fft(fft_input.buffer, output, n_fft);
+        auto res = ei::fft::hw_r2c_fft(fft_input, output, n_fft);
         if (handle_fft_hw_failure(res, n_fft)) {
             // fallback to software
-            return software_rfft(fft_input.buffer, output, n_fft, n_fft_out_features);
+            return software_rfft(fft_input, output, n_fft, n_fft_out_features);
         }
 
         return EIDSP_OK;
@@ -1744,6 +1762,15 @@ public:
     static int software_rfft(float *fft_input, fft_complex_t *output, size_t n_fft, size_t n_fft_out_features)
     {
     #if EIDSP_INCLUDE_KISSFFT || !defined(EIDSP_INCLUDE_KISSFFT)
+    #if EIDSP_FFT_PLAN_CACHE
+        fft_plan_t *plan = fft_plan_cache::get(n_fft);
+        if (!plan) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        kiss_fftr(plan->cfg, fft_input, (kiss_fft_cpx*)output);
+
+        return EIDSP_OK;
+    #else
         // create fftr context
         size_t kiss_fftr_mem_length;
 
@@ -1760,6 +1787,7 @@ public:
         ei_dsp_free(cfg, kiss_fftr_mem_length);
 
         return EIDSP_OK;
+    #endif // EIDSP_FFT_PLAN_CACHE
     #else
         return EIDSP_NOT_SUPPORTED;
     #endif
@@ -2066,6 +2094,55 @@ public:
         return EIDSP_OK;
     }
 
+    /**
+     * Power spectrum of several frames of the same length, e.g. all the
+     * frames of a spectrogram. Zeros in the output are replaced by 1e-10
+     * (see zero_handling), so the result can go straight into a log.
+     * @param frames First frame, frame f starts at frames + f * frame_stride
+     * @param n_frames Number of frames
+     * @param frame_stride Distance between frame starts (frames may overlap)
+     * @param frame_size Size of each frame
+     * @param out_buffer n_frames rows of out_buffer_cols
+     * @param out_buffer_cols Should be fft_points / 2 + 1
+     * @param fft_points (int): The length of FFT. If fft_length is greater than frame_len, the frames will be zero-padded.
+     * @returns EIDSP_OK if OK
+     */
+    static int power_spectrum_batch(
+        const float *frames,
+        size_t n_frames,
+        size_t frame_stride,
+        size_t frame_size,
+        float *out_buffer,
+        size_t out_buffer_cols,
+        uint16_t fft_points)
+    {
+        if (out_buffer_cols != static_cast<size_t>(fft_points / 2 + 1)) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+#if EIDSP_BATCH_RFFT
+        if (rfft_batch::power_spectrum(frames, n_frames, frame_stride, frame_size,
+                                       out_buffer, out_buffer_cols, fft_points)) {
+            return EIDSP_OK;
+        }
+#endif
+
+        for (size_t ix = 0; ix < n_frames; ix++) {
+            int r = power_spectrum(
+                const_cast<float *>(frames + ix * frame_stride),
+                frame_size,
+                out_buffer + ix * out_buffer_cols,
+                out_buffer_cols,
+                fft_points);
+            if (r != EIDSP_OK) {
+                return r;
+            }
+        }
+        zero_handling(out_buffer, n_frames * out_buffer_cols);
+
+        return EIDSP_OK;
+    }
+
     static int welch_max_hold(
         float *input,
         size_t input_size,
@@ -2549,6 +2626,19 @@ struct fmat {
 };
 } // namespace ei
 
+__attribute__((unused)) static bool find_feature_by_idx(ei_feature_t* mtx, ei_feature_t** feature, uint32_t mtx_id, size_t mtx_size) {
+    for (uint32_t i = 0; i < mtx_size; i++) {
+        if (mtx[i].matrix == NULL) {
+            continue;
+        }
+        if (mtx[i].blockId == mtx_id || mtx[i].blockId == 0) {
+            *feature = &mtx[i];
+            return true;
+        }
+    }
+    return false;
+}
+
 __attribute__((unused)) static bool find_mtx_by_idx(ei_feature_t* mtx, ei::matrix_t** matrix, uint32_t mtx_id, size_t mtx_size) {
     for (uint32_t i = 0; i < mtx_size; i++) {
         EI_LOGD("mtx[%d].blockId = %d\n", i, mtx[i].blockId);
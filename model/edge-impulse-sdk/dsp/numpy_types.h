@@ -715,6 +715,11 @@ typedef struct ei_feature_t {
         ei::matrix_u8_t* matrix_u8;
     };
     uint32_t blockId;
+    // standard scaler the consumer still has to apply to `matrix`, feature i
+    // is (x - pending_mean[i]) * pending_scale[i]; nullptr (as zeroed) if
+    // there is none or it's already applied
+    const float* pending_mean;
+    const float* pending_scale;
 
     void* operator new(size_t size) {
         return ei_malloc(size);
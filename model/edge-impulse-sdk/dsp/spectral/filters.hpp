@@ -32,6 +32,7 @@
 #define _EIDSP_SPECTRAL_FILTERS_H_
 
 #include <math.h>
+#include <string.h>
 #include "../numpy.hpp"
 
 #ifndef M_PI
@@ -41,6 +42,147 @@
 namespace ei {
 namespace spectral {
 namespace filters {
+    /**
+     * Cascade of biquads implementing an even-order Butterworth low- or high-pass
+     * filter. The coefficients are computed once in configure(), and the filter
+     * state carries over from one process() call to the next, so a stream can
+     * be filtered in pieces as samples arrive. reset() starts from rest again.
+     * Holds everything inline, no allocations.
+     */
+    class butterworth_filter {
+    public:
+        static const int max_order = 16;
+
+        butterworth_filter() : n_steps(0), highpass(false), order(0), fs(0), cutoff(0) {
+            reset();
+        }
+
+        /**
+         * Compute the coefficients. Does nothing when called again with the
+         * same parameters, and keeps the state either way.
+         * @param is_highpass High-pass instead of low-pass
+         * @param filter_order Even filter order (between 2..16)
+         * @param sampling_freq Sample frequency of the signal
+         * @param cutoff_freq Cut-off frequency of the signal
+         */
+        void configure(bool is_highpass, int filter_order, float sampling_freq, float cutoff_freq)
+        {
+            if (filter_order > max_order) {
+                filter_order = max_order;
+            }
+            if (n_steps == filter_order / 2 && highpass == is_highpass && order == filter_order &&
+                fs == sampling_freq && cutoff == cutoff_freq) {
+                return;
+            }
+            highpass = is_highpass;
+            order = filter_order;
+            fs = sampling_freq;
+            cutoff = cutoff_freq;
+            n_steps = filter_order / 2;
+
+            float a = tan(M_PI * cutoff_freq / sampling_freq);
+            float a2 = pow(a, 2);
+
+            for (int ix = 0; ix < n_steps; ix++) {
+                float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
+                float scale = a2 + (2.0 * a * r) + 1.0;
+                A[ix] = highpass ? 1.0f / scale : a2 / scale;
+                d1[ix] = 2.0 * (1 - a2) / scale;
+                d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / scale;
+            }
+        }
+
+        void reset()
+        {
+            for (int ix = 0; ix < max_order / 2; ix++) {
+                w1[ix] = 0;
+                w2[ix] = 0;
+            }
+        }
+
+        /**
+         * Filter `size` samples following the ones of the previous call.
+         * src and dest may be the same array.
+         */
+        void process(const float *src, float *dest, size_t size)
+        {
+            switch (n_steps) {
+                case 1: dispatch<1>(src, dest, size); break;
+                case 2: dispatch<2>(src, dest, size); break;
+                case 3: dispatch<3>(src, dest, size); break;
+                case 4: dispatch<4>(src, dest, size); break;
+                case 5: dispatch<5>(src, dest, size); break;
+                case 6: dispatch<6>(src, dest, size); break;
+                case 7: dispatch<7>(src, dest, size); break;
+                case 8: dispatch<8>(src, dest, size); break;
+                default: // order 0 or 1, nothing to filter
+                    if (dest != src) {
+                        memcpy(dest, src, size * sizeof(float));
+                    }
+                    break;
+            }
+        }
+
+    private:
+        template<int steps>
+        void dispatch(const float *src, float *dest, size_t size)
+        {
+            if (highpass) {
+                run<true, steps>(src, dest, size);
+            }
+            else {
+                run<false, steps>(src, dest, size);
+            }
+        }
+
+        // The number of sections is a compile-time constant, so the state
+        // stays in registers and the sections of consecutive samples overlap.
+        template<bool is_highpass, int steps>
+        void run(const float *src, float *dest, size_t size)
+        {
+            // keep the state in locals, dest may alias it as far as the compiler knows
+            float s1[steps], s2[steps];
+            for (int i = 0; i < steps; i++) {
+                s1[i] = w1[i];
+                s2[i] = w2[i];
+            }
+
+            for (size_t sx = 0; sx < size; sx++) {
+                float v = src[sx];
+
+                for (int i = 0; i < steps; i++) {
+                    float w0 = d1[i] * s1[i] + d2[i] * s2[i] + v;
+                    if (is_highpass) {
+                        v = A[i] * (w0 - (2.0 * s1[i]) + s2[i]);
+                    }
+                    else {
+                        v = A[i] * (w0 + (2.0 * s1[i]) + s2[i]);
+                    }
+                    s2[i] = s1[i];
+                    s1[i] = w0;
+                }
+
+                dest[sx] = v;
+            }
+
+            for (int i = 0; i < steps; i++) {
+                w1[i] = s1[i];
+                w2[i] = s2[i];
+            }
+        }
+
+        int n_steps;
+        bool highpass;
+        int order;
+        float fs;
+        float cutoff;
+        float A[max_order / 2];
+        float d1[max_order / 2];
+        float d2[max_order / 2];
+        float w1[max_order / 2];
+        float w2[max_order / 2];
+    };
+
     /**
      * The Butterworth filter has maximally flat frequency response in the passband.
      * @param filter_order Even filter order (between 2..8)
@@ -50,7 +192,7 @@ namespace filters {
      * @param dest Destination array
      * @param size Size of both source and destination arrays
      */
-    static void butterworth_lowpass(
+    __attribute__((unused)) static void butterworth_lowpass(
         int filter_order,
         float sampling_freq,
         float cutoff_freq,
@@ -58,43 +200,9 @@ namespace filters {
         float *dest,
         size_t size)
     {
-        int n_steps = filter_order / 2;
-        float a = tan(M_PI * cutoff_freq / sampling_freq);
-        float a2 = pow(a, 2);
-        float *A = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *d1 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *d2 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w0 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w1 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w2 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-
-        // Calculate the filter parameters
-        for(int ix = 0; ix < n_steps; ix++) {
-            float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
-            sampling_freq = a2 + (2.0 * a * r) + 1.0;
-            A[ix] = a2 / sampling_freq;
-            d1[ix] = 2.0 * (1 - a2) / sampling_freq;
-            d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
-        }
-
-        // Apply the filter
-        for (size_t sx = 0; sx < size; sx++) {
-            dest[sx] = src[sx];
-
-            for (int i = 0; i < n_steps; i++) {
-                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
-                dest[sx] = A[i] * (w0[i] + (2.0 * w1[i]) + w2[i]);
-                w2[i] = w1[i];
-                w1[i] = w0[i];
-            }
-        }
-
-        ei_dsp_free(A, n_steps*sizeof(float));
-        ei_dsp_free(d1, n_steps*sizeof(float));
-        ei_dsp_free(d2, n_steps*sizeof(float));
-        ei_dsp_free(w0, n_steps*sizeof(float));
-        ei_dsp_free(w1, n_steps*sizeof(float));
-        ei_dsp_free(w2, n_steps*sizeof(float));
+        butterworth_filter filter;
+        filter.configure(false, filter_order, sampling_freq, cutoff_freq);
+        filter.process(src, dest, size);
     }
 
     /**
@@ -106,7 +214,7 @@ namespace filters {
      * @param dest Destination array
      * @param size Size of both source and destination arrays
      */
-    static void butterworth_highpass(
+    __attribute__((unused)) static void butterworth_highpass(
         int filter_order,
         float sampling_freq,
         float cutoff_freq,
@@ -114,43 +222,9 @@ namespace filters {
         float *dest,
         size_t size)
     {
-        int n_steps = filter_order / 2;
-        float a = tan(M_PI * cutoff_freq / sampling_freq);
-        float a2 = pow(a, 2);
-        float *A = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *d1 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *d2 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w0 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w1 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w2 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-
-        // Calculate the filter parameters
-        for (int ix = 0; ix < n_steps; ix++) {
-            float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
-            sampling_freq = a2 + (2.0 * a * r) + 1.0;
-            A[ix] = 1.0f / sampling_freq;
-            d1[ix] = 2.0 * (1 - a2) / sampling_freq;
-            d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
-        }
-
-        // Apply the filter
-        for (size_t sx = 0; sx < size; sx++) {
-            dest[sx] = src[sx];
-
-            for (int i = 0; i < n_steps; i++) {
-                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
-                dest[sx] = A[i] * (w0[i] - (2.0 * w1[i]) + w2[i]);
-                w2[i] = w1[i];
-                w1[i] = w0[i];
-            }
-        }
-
-        ei_dsp_free(A, n_steps*sizeof(float));
-        ei_dsp_free(d1, n_steps*sizeof(float));
-        ei_dsp_free(d2, n_steps*sizeof(float));
-        ei_dsp_free(w0, n_steps*sizeof(float));
-        ei_dsp_free(w1, n_steps*sizeof(float));
-        ei_dsp_free(w2, n_steps*sizeof(float));
+        butterworth_filter filter;
+        filter.configure(true, filter_order, sampling_freq, cutoff_freq);
+        filter.process(src, dest, size);
     }
 
 } // namespace filters
@@ -120,11 +120,12 @@ namespace processing {
         float filter_cutoff,
         uint8_t filter_order)
     {
+        // same coefficients for every row, each row starts from rest
+        filters::butterworth_filter filter;
+        filter.configure(false, filter_order, sampling_frequency, filter_cutoff);
         for (size_t row = 0; row < matrix->rows; row++) {
-            filters::butterworth_lowpass(
-                filter_order,
-                sampling_frequency,
-                filter_cutoff,
+            filter.reset();
+            filter.process(
                 matrix->buffer + (row * matrix->cols),
                 matrix->buffer + (row * matrix->cols),
                 matrix->cols);
@@ -149,11 +150,12 @@ namespace processing {
         float filter_cutoff,
         uint8_t filter_order)
     {
+        // same coefficients for every row, each row starts from rest
+        filters::butterworth_filter filter;
+        filter.configure(true, filter_order, sampling_frequency, filter_cutoff);
         for (size_t row = 0; row < matrix->rows; row++) {
-            filters::butterworth_highpass(
-                filter_order,
-                sampling_frequency,
-                filter_cutoff,
+            filter.reset();
+            filter.process(
                 matrix->buffer + (row * matrix->cols),
                 matrix->buffer + (row * matrix->cols),
                 matrix->cols);
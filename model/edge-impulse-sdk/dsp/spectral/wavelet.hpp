@@ -70,7 +70,46 @@ inline void histo(const fvec &x, size_t nbins, fvec &h, bool normalize = false)
 }
 
 class wavelet {
+public:
+    // Decomposition filters of one wavelet, in the order dwt() applies them
+    struct filter_bank {
+        size_t size;
+        float h[20];
+        float g[20];
+    };
+
+    // Scratch for extract_wavelet_features(). Sized by the first window and
+    // reused after that, keep one per DSP block instance.
+    struct workspace {
+        fvec x_padded;
+        fvec a;
+        fvec d;
+        fvec features;
+        fvec select;    // copy of a sub-band for the percentiles
+        fvec hist;      // entropy histogram
+    };
+
+    /**
+     * Look up a wavelet by name (e.g. "bior1.5") once, ahead of extraction
+     * @returns false if the name is unknown
+     */
+    static bool find_filter_bank(const char *wav, filter_bank *bank)
+    {
+        fvec h;
+        fvec g;
+        find_filter(wav, h, g);
+        if (h.size() == 0 || h.size() > 20 || h.size() != g.size()) {
+            return false;
+        }
+        bank->size = h.size();
+        for (size_t i = 0; i < bank->size; i++) {
+            bank->h[i] = h[i];
+            bank->g[i] = g[i];
+        }
+        return true;
+    }
 
+private:
     static constexpr size_t NUM_FEATHERS_PER_COMP = 14;
 
     template <size_t wave_size>
@@ -137,9 +176,10 @@ class wavelet {
         else if (strcmp(wav, "sym8") == 0) get_filter<16>(sym8, h, g);
         else if (strcmp(wav, "sym9") == 0) get_filter<18>(sym9, h, g);
         else if (strcmp(wav, "sym10") == 0) get_filter<20>(sym10, h, g);
-        else assert(0); // wavelet not in the list
+        // else: wavelet not in the list, h and g stay empty
     }
 
+#if EIDSP_USE_CMSIS_DSP
     static void calculate_entropy(const fvec &y, fvec &features)
     {
         fvec h;
@@ -154,38 +194,6 @@ class wavelet {
         features.push_back(entropy);
     }
 
-    static float get_percentile_from_sorted(const fvec &sorted, float percentile)
-    {
-        // adding 0.5 is a trick to get rounding out of C flooring behavior during cast
-        size_t index = (size_t) ((percentile * (sorted.size()-1)) + 0.5);
-        return sorted[index];
-    }
-
-    static void calculate_statistics(const fvec &y, fvec &features, float mean)
-    {
-        fvec sorted = y;
-        std::sort(sorted.begin(), sorted.end());
-        features.push_back(get_percentile_from_sorted(sorted,0.05));
-        features.push_back(get_percentile_from_sorted(sorted,0.25));
-        features.push_back(get_percentile_from_sorted(sorted,0.75));
-        features.push_back(get_percentile_from_sorted(sorted,0.95));
-        features.push_back(get_percentile_from_sorted(sorted,0.5));
-
-        matrix_t x(1, y.size(), const_cast<float *>(y.data()));
-        matrix_t out(1, 1);
-
-        features.push_back(mean);
-        if (numpy::stdev(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        features.push_back(numpy::variance(const_cast<float *>(y.data()), y.size()));
-        if (numpy::rms(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        if (numpy::skew(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        if (numpy::kurtosis(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-    }
-
     static void calculate_crossings(const fvec &y, fvec &features, float mean)
     {
         size_t zc = 0;
@@ -204,38 +212,146 @@ class wavelet {
         }
         features.push_back(mc / (float)y.size());
     }
+#endif
+
+    /**
+     * Push the 5th, 25th, 75th, 95th and 50th percentile of y (nearest rank,
+     * same as indexing the sorted data). Selects the ranks in ascending order
+     * with nth_element, each one narrowing the range of the next, instead of
+     * sorting everything.
+     * @param select Scratch, overwritten with a permutation of y
+     */
+    static void calculate_percentiles(const fvec &y, fvec &select, fvec &features)
+    {
+        static const float percentiles[] = { 0.05f, 0.25f, 0.5f, 0.75f, 0.95f };
+        float values[5];
+
+        select.resize(y.size());
+        std::copy(y.begin(), y.end(), select.begin());
+
+        fvec::iterator first = select.begin();
+        for (size_t i = 0; i < 5; i++) {
+            // adding 0.5 is a trick to get rounding out of C flooring behavior during cast
+            size_t index = (size_t) ((percentiles[i] * (y.size()-1)) + 0.5);
+            fvec::iterator nth = select.begin() + index;
+            if (nth >= first) {
+                std::nth_element(first, nth, select.end());
+                first = nth + 1;
+            }
+            values[i] = *nth;
+        }
+
+        features.push_back(values[0]);
+        features.push_back(values[1]);
+        features.push_back(values[3]);
+        features.push_back(values[4]);
+        features.push_back(values[2]);
+    }
 
-    static void
-    dwt(const float *x, size_t nx, const float *h, const float *g, size_t nh, fvec &a, fvec &d)
+#if EIDSP_USE_CMSIS_DSP
+    static void calculate_statistics(const fvec &y, fvec &features, float mean, fvec &select)
     {
-        assert(nh <= 20 && nh > 0 && nx > 0);
-        size_t nx_padded = nx + nh * 2 - 2;
-        fvec x_padded(nx_padded);
+        calculate_percentiles(y, select, features);
+
+        matrix_t x(1, y.size(), const_cast<float *>(y.data()));
+        matrix_t out(1, 1);
 
+        features.push_back(mean);
+        if (numpy::stdev(&x, &out) == EIDSP_OK)
+            features.push_back(out.get_row_ptr(0)[0]);
+        features.push_back(numpy::variance(const_cast<float *>(y.data()), y.size()));
+        if (numpy::rms(&x, &out) == EIDSP_OK)
+            features.push_back(out.get_row_ptr(0)[0]);
+        if (numpy::skew(&x, &out) == EIDSP_OK)
+            features.push_back(out.get_row_ptr(0)[0]);
+        if (numpy::kurtosis(&x, &out) == EIDSP_OK)
+            features.push_back(out.get_row_ptr(0)[0]);
+    }
+#endif
+
+    /**
+     * One level of the DWT with the filter length fixed at compile time, so the
+     * taps unroll and both filters run over each input position in one pass.
+     * Each output is still summed tap by tap from 0.0f, the same order dot()
+     * uses, so the results don't change. x may alias a.
+     * @param x_padded Scratch for the padded input, nx + 2 * nh - 2 values
+     * @param a, d Approximation and detail outputs, (nx + nh - 1) / 2 values
+     */
+    template <size_t nh>
+    static size_t dwt_fixed(
+        const float *x,
+        size_t nx,
+        const float *h,
+        const float *g,
+        float *x_padded,
+        float *a,
+        float *d)
+    {
         // symmetric padding (default in PyWavelet)
-        for (size_t i = 0; i < nh - 2; i++)
+        for (size_t i = 0; i + 2 < nh; i++)
             x_padded[i] = x[nh - 3 - i];
         for (size_t i = 0; i < nx; i++)
             x_padded[i + nh - 2] = x[i];
         for (size_t i = 0; i < nh; i++)
             x_padded[i + nx + nh - 2] = x[nx - 1 - i];
 
-        size_t ny = (nx + nh - 1) / 2;
-        a.resize(ny);
-        d.resize(ny);
+        float hh[nh], gg[nh];
+        for (size_t k = 0; k < nh; k++) {
+            hh[k] = h[k];
+            gg[k] = g[k];
+        }
 
         // decimate and filter
-        const float *xx = x_padded.data();
+        const size_t ny = (nx + nh - 1) / 2;
         for (size_t i = 0; i < ny; i++) {
-            a[i] = dot(xx + 2 * i, h, nh);
-            d[i] = dot(xx + 2 * i, g, nh);
+            const float *xx = x_padded + 2 * i;
+            float sa = 0.0f;
+            float sd = 0.0f;
+            for (size_t k = 0; k < nh; k++) {
+                sa += xx[k] * hh[k];
+                sd += xx[k] * gg[k];
+            }
+            a[i] = sa;
+            d[i] = sd;
         }
 
-        numpy::underflow_handling(d.data(), d.size());
-        numpy::underflow_handling(a.data(), a.size());
+        numpy::underflow_handling(d, ny);
+        numpy::underflow_handling(a, ny);
+        return ny;
+    }
+
+    static void dwt(const float *x, size_t nx, const filter_bank &bank, workspace *ws)
+    {
+        const size_t nh = bank.size;
+        assert(nh <= 20 && nh > 0 && nx > 0);
+
+        // the vectors only ever shrink after the first window, so no allocations
+        ws->x_padded.resize(nx + nh * 2 - 2);
+        const size_t ny = (nx + nh - 1) / 2;
+        // x may be ws->a itself, which is fine: it is copied into x_padded first
+        ws->a.resize(ny);
+        ws->d.resize(ny);
+
+        float *xp = ws->x_padded.data();
+        float *a = ws->a.data();
+        float *d = ws->d.data();
+        switch (nh) {
+            case 2: dwt_fixed<2>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 4: dwt_fixed<4>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 6: dwt_fixed<6>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 8: dwt_fixed<8>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 10: dwt_fixed<10>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 12: dwt_fixed<12>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 14: dwt_fixed<14>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 16: dwt_fixed<16>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 18: dwt_fixed<18>(x, nx, bank.h, bank.g, xp, a, d); break;
+            case 20: dwt_fixed<20>(x, nx, bank.h, bank.g, xp, a, d); break;
+            default: assert(0); // every wavelet we know has an even length up to 20
+        }
     }
 
-    static void extract_features(fvec& y, fvec &features)
+#if EIDSP_USE_CMSIS_DSP
+    static void extract_features(const fvec& y, workspace *ws, fvec &features)
     {
         matrix_t x(1, y.size(), const_cast<float *>(y.data()));
         matrix_t out(1, 1);
@@ -245,30 +361,113 @@ class wavelet {
 
         calculate_entropy(y, features);
         calculate_crossings(y, features, mean);
-        calculate_statistics(y, features, mean);
+        calculate_statistics(y, features, mean, ws->select);
     }
+#else
+    /**
+     * All 14 features of one sub-band in two sweeps over the data: sum, sum of
+     * squares and range first, then the centered moments, both crossing counts
+     * and the entropy histogram together. Every sum runs in the same order as
+     * the numpy helpers it replaces, so the values are unchanged.
+     */
+    static void extract_features(const fvec& y, workspace *ws, fvec &features)
+    {
+        const size_t n = y.size();
+        const size_t nbins = 100;
+
+        float sum = 0.0f;
+        float sum_sq = 0.0f;
+        float min = y[0];
+        float max = y[0];
+        for (size_t i = 0; i < n; i++) {
+            float v = y[i];
+            sum += v;
+            sum_sq += v * v;
+            if (v < min) min = v;
+            if (max < v) max = v;
+        }
+        const float mean = sum / n;
+        const float step = (max - min) / nbins;
+
+        fvec &h = ws->hist;
+        h.assign(nbins, 0.0f);
+
+        float m_2 = 0.0f;
+        float m_3 = 0.0f;
+        float m_4 = 0.0f;
+        size_t zc = 0;
+        size_t mc = 0;
+        for (size_t i = 0; i < n; i++) {
+            float diff = y[i] - mean;
+            float square_diff = diff * diff;
+            m_2 += square_diff;
+            m_3 += diff * diff * diff;
+            m_4 += square_diff * square_diff;
+
+            if (i > 0) {
+                if (y[i] * y[i - 1] < 0) {
+                    zc++;
+                }
+                if ((y[i] - mean) * (y[i - 1] - mean) < 0) {
+                    mc++;
+                }
+            }
+
+            size_t bin = (y[i] - min) / step;
+            if (bin >= nbins)
+                bin = nbins - 1;
+            h[bin]++;
+        }
+
+        // entropy = -sum(prob * log(prob)
+        // (the bin counts are whole numbers, so their float sum is exactly n)
+        float entropy = 0.0f;
+        const float total = numpy::sum(h.data(), nbins);
+        for (size_t i = 0; i < nbins; i++) {
+            float p = h[i] / total;
+            if (p > 0.0f) {
+                entropy -= p * log(p);
+            }
+        }
+        features.push_back(entropy);
+        features.push_back(zc / (float)n);
+        features.push_back(mc / (float)n);
+
+        calculate_percentiles(y, ws->select, features);
 
-    static void
-    wavedec_features(const float *x, int len, const char *wav, int level, fvec &features)
+        const float m_2n = m_2 / n;
+        const float m_2n_cubed = sqrt(m_2n * m_2n * m_2n);
+        const float variance_sq = m_2n * m_2n;
+
+        features.push_back(mean);
+        features.push_back(sqrt(m_2 / n));                          // stdev
+        features.push_back(m_2 / (n - 1));                          // variance (ddof 1)
+        features.push_back(sqrt(sum_sq / static_cast<float>(n)));   // rms
+        features.push_back(m_2n_cubed == 0.0f ? 0.0f : (m_3 / n) / m_2n_cubed);        // skew
+        features.push_back(variance_sq == 0.0f ? -3.0f : ((m_4 / n) / variance_sq) - 3.0f); // kurtosis
+    }
+#endif
+
+    static void wavedec_features(
+        const float *x,
+        int len,
+        const filter_bank &bank,
+        int level,
+        workspace *ws,
+        fvec &features)
     {
         assert(level > 0 && level < 8);
 
-        fvec h;
-        fvec g;
-        find_filter(wav, h, g);
-
         features.clear();
-        fvec a;
-        fvec d;
-        dwt(x, len, h.data(), g.data(), h.size(), a, d);
-        extract_features(d, features);
+        dwt(x, len, bank, ws);
+        extract_features(ws->d, ws, features);
 
         for (int l = 1; l < level; l++) {
-            dwt(a.data(), a.size(), h.data(), g.data(), h.size(), a, d);
-            extract_features(d, features);
+            dwt(ws->a.data(), ws->a.size(), bank, ws);
+            extract_features(ws->d, ws, features);
         }
 
-        extract_features(a, features);
+        extract_features(ws->a, ws, features);
 
         for (int l = 0; l <= level / 2; l++) { // reverse order to match python results.
             for (int i = 0; i < (int)NUM_FEATHERS_PER_COMP; i++) {
@@ -279,14 +478,20 @@ class wavelet {
         }
     }
 
-    static int dwt_features(const float *x, int len, const char *wav, int level, fvec &features)
+    static int dwt_features(
+        const float *x,
+        int len,
+        const filter_bank &bank,
+        int level,
+        workspace *ws,
+        fvec &features)
     {
         assert(level <= 7);
 
-        assert(features.size() == 0); // make sure features is empty
+        features.clear();
         features.reserve((level + 1) * NUM_FEATHERS_PER_COMP);
 
-        wavedec_features(x, len, wav, level, features);
+        wavedec_features(x, len, bank, level, ws, features);
 
         return features.size();
     }
@@ -303,6 +508,26 @@ public:
         matrix_t *output_matrix,
         ei_dsp_config_spectral_analysis_t *config,
         const float sampling_freq)
+    {
+        filter_bank bank;
+        if (!find_filter_bank(config->wavelet, &bank)) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+        workspace ws;
+        return extract_wavelet_features(input_matrix, output_matrix, config, sampling_freq, bank, &ws);
+    }
+
+    /**
+     * Same as above, with the filters looked up ahead of time and all scratch
+     * in `ws`, so repeated calls don't allocate
+     */
+    static int extract_wavelet_features(
+        matrix_t *input_matrix,
+        matrix_t *output_matrix,
+        ei_dsp_config_spectral_analysis_t *config,
+        const float sampling_freq,
+        const filter_bank &bank,
+        workspace *ws)
     {
         // transpose the matrix so we have one row per axis
         numpy::transpose_in_place(input_matrix);
@@ -341,12 +566,13 @@ public:
             if (!check_min_size(data_size, config->wavelet_level))
                 EIDSP_ERR(EIDSP_BUFFER_SIZE_MISMATCH);
 
-            fvec features;
+            fvec &features = ws->features;
             size_t num_features = dwt_features(
                 data_window,
                 data_size,
-                config->wavelet,
+                bank,
                 config->wavelet_level,
+                ws,
                 features);
 
             assert(num_features == output_matrix->cols / input_matrix->rows);
@@ -602,9 +602,20 @@ public:
             *(out_features->buffer + i) = 0;
         }
 
-        for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
+        // frames go through the power spectrum a batch at a time
+#if EIDSP_BATCH_RFFT
+        const size_t batch_size = ei::rfft_batch::LANES;
+#else
+        const size_t batch_size = 1;
+#endif
+        const size_t frame_count = stack_frame_info.frame_ixs.size();
+        EI_DSP_MATRIX(signal_frames, batch_size, stack_frame_info.frame_length);
+
+        for (size_t ix = 0; ix < frame_count; ix++) {
             // get signal data from the audio file
-            EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
+            const size_t batch_ix = ix % batch_size;
+            matrix_t signal_frame(1, stack_frame_info.frame_length, signal_frames.get_row_ptr(batch_ix));
+            memset(signal_frame.buffer, 0, stack_frame_info.frame_length * sizeof(float));
 
             // don't read outside of the audio buffer... we'll automatically zero pad then
             size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
@@ -642,21 +653,26 @@ public:
                 }
             }
 
-            ret = numpy::power_spectrum(
-                signal_frame.buffer,
+            if (batch_ix != batch_size - 1 && ix != frame_count - 1) {
+                continue;
+            }
+
+            // also does the zero handling
+            const size_t first_ix = ix - batch_ix;
+            ret = numpy::power_spectrum_batch(
+                signal_frames.buffer,
+                batch_ix + 1,
+                stack_frame_info.frame_length,
                 stack_frame_info.frame_length,
-                out_features->buffer + (ix * coefficients),
+                out_features->buffer + (first_ix * coefficients),
                 coefficients,
                 fft_length
             );
-
             if (ret != 0) {
                 EIDSP_ERR(ret);
             }
         }
 
-        numpy::zero_handling(out_features);
-
         return EIDSP_OK;
     }
 
@@ -0,0 +1,324 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FULLY_CONNECTED_X86_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FULLY_CONNECTED_X86_H_
+
+// int8 x int8 fully connected for x86-64 hosts, picked at runtime:
+//   - AVX-VNNI / AVX512-VNNI: vpdpbusd on (input + 128) as u8 against the
+//     int8 weights, corrected with the weight row sums afterwards
+//   - AVX2: inputs and weights widened to int16 with their offsets folded in,
+//     then vpmaddwd
+// vpmaddubsw is not used, its int16 pair sums saturate for int8 weights
+// against u8 inputs. Every path sums the exact same int32 terms as
+// reference_integer_ops::FullyConnected and requantizes the same way, so
+// the outputs are bit-exact (integer sums don't depend on order).
+
+#include <algorithm>
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "edge-impulse-sdk/tensorflow/lite/kernels/internal/common.h"
+
+namespace tflite {
+namespace optimized_integer_ops {
+namespace x86 {
+
+// output channels per register block, they share the input loads
+static const int CHANNEL_BLOCK = 4;
+
+struct fc_args_t {
+    const FullyConnectedParams *params;
+    int batches;
+    int output_depth;
+    int accum_depth;
+    const int8_t *input;
+    const int8_t *filter;
+    const int32_t *bias;
+    int8_t *output;
+};
+
+static inline __attribute__((always_inline, target("avx2"))) int32_t hsum_epi32(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+static inline void store_outputs(const fc_args_t &a, int b, int c, int n, const int32_t *acc) {
+    const FullyConnectedParams &p = *a.params;
+    for (int k = 0; k < n; k++) {
+        int32_t v = acc[k];
+        if (a.bias) {
+            v += a.bias[c + k];
+        }
+        int32_t scaled = MultiplyByQuantizedMultiplier(v, p.output_multiplier, p.output_shift);
+        scaled += p.output_offset;
+        scaled = std::max(scaled, p.quantized_activation_min);
+        scaled = std::min(scaled, p.quantized_activation_max);
+        a.output[b * a.output_depth + c + k] = static_cast<int8_t>(scaled);
+    }
+}
+
+/**
+ * sum over d of (w[d] + weights_offset) * (x[d] + input_offset) for
+ * N channels, from d = `from` on, 16 at a time with vpmaddwd, then scalar
+ */
+template<int N>
+static inline __attribute__((always_inline, target("avx2"))) void dot_madd(
+    const fc_args_t &a, const int8_t *x, const int8_t *const *w, int from, int32_t *acc)
+{
+    const int depth = a.accum_depth;
+    const int32_t x_off = a.params->input_offset;
+    const int32_t w_off = a.params->weights_offset;
+    const __m256i x_off16 = _mm256_set1_epi16((int16_t)x_off);
+    const __m256i w_off16 = _mm256_set1_epi16((int16_t)w_off);
+
+    __m256i sum[N];
+    for (int k = 0; k < N; k++) {
+        sum[k] = _mm256_setzero_si256();
+    }
+
+    int d = from;
+    for (; d + 16 <= depth; d += 16) {
+        // both fit int16 with their offset added: [-255, 255]
+        const __m256i xv = _mm256_add_epi16(
+            _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(x + d))), x_off16);
+        for (int k = 0; k < N; k++) {
+            const __m256i wv = _mm256_add_epi16(
+                _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(w[k] + d))), w_off16);
+            sum[k] = _mm256_add_epi32(sum[k], _mm256_madd_epi16(wv, xv));
+        }
+    }
+
+    for (int k = 0; k < N; k++) {
+        int32_t s = hsum_epi32(sum[k]);
+        for (int dd = d; dd < depth; dd++) {
+            s += (w[k][dd] + w_off) * (x[dd] + x_off);
+        }
+        acc[k] += s;
+    }
+}
+
+template<int N>
+static inline __attribute__((always_inline, target("avx2"))) void fc_block_avx2(
+    const fc_args_t &a, int b, int c)
+{
+    const int8_t *x = a.input + b * a.accum_depth;
+    const int8_t *w[N];
+    int32_t acc[N];
+    for (int k = 0; k < N; k++) {
+        w[k] = a.filter + (c + k) * a.accum_depth;
+        acc[k] = 0;
+    }
+    dot_madd<N>(a, x, w, 0, acc);
+    store_outputs(a, b, c, N, acc);
+}
+
+__attribute__((target("avx2")))
+static void fully_connected_avx2(const fc_args_t &a) {
+    for (int b = 0; b < a.batches; b++) {
+        int c = 0;
+        for (; c + CHANNEL_BLOCK <= a.output_depth; c += CHANNEL_BLOCK) {
+            fc_block_avx2<CHANNEL_BLOCK>(a, b, c);
+        }
+        for (; c < a.output_depth; c++) {
+            fc_block_avx2<1>(a, b, c);
+        }
+    }
+}
+
+/**
+ * VNNI block, weights_offset must be 0. With u = x + 128 (x ^ 0x80 as u8):
+ * sum w * (x + input_offset) = sum w * u + (input_offset - 128) * sum w
+ */
+#define EI_FC_VNNI_BLOCK(NAME, TARGET, DPBUSD)                                          \
+template<int N>                                                                         \
+static inline __attribute__((always_inline, target(TARGET))) void NAME(                 \
+    const fc_args_t &a, int b, int c)                                                   \
+{                                                                                       \
+    const int depth = a.accum_depth;                                                    \
+    const int8_t *x = a.input + b * depth;                                              \
+    const int8_t *w[N];                                                                 \
+    __m256i dot[N], wsum[N];                                                            \
+    for (int k = 0; k < N; k++) {                                                       \
+        w[k] = a.filter + (c + k) * depth;                                              \
+        dot[k] = _mm256_setzero_si256();                                                \
+        wsum[k] = _mm256_setzero_si256();                                               \
+    }                                                                                   \
+    const __m256i flip = _mm256_set1_epi8((char)0x80);                                  \
+    const __m256i ones = _mm256_set1_epi8(1);                                           \
+    int d = 0;                                                                          \
+    for (; d + 32 <= depth; d += 32) {                                                  \
+        const __m256i u = _mm256_xor_si256(                                             \
+            _mm256_loadu_si256((const __m256i *)(x + d)), flip);                        \
+        for (int k = 0; k < N; k++) {                                                   \
+            const __m256i wv = _mm256_loadu_si256((const __m256i *)(w[k] + d));         \
+            dot[k] = DPBUSD(dot[k], u, wv);                                             \
+            wsum[k] = DPBUSD(wsum[k], ones, wv);                                        \
+        }                                                                               \
+    }                                                                                   \
+    int32_t acc[N];                                                                     \
+    for (int k = 0; k < N; k++) {                                                       \
+        acc[k] = hsum_epi32(dot[k]) + (a.params->input_offset - 128) * hsum_epi32(wsum[k]); \
+    }                                                                                   \
+    dot_madd<N>(a, x, w, d, acc);                                                       \
+    store_outputs(a, b, c, N, acc);                                                     \
+}
+
+#define EI_FC_VNNI(NAME, BLOCK, TARGET)                                                 \
+__attribute__((target(TARGET)))                                                         \
+static void NAME(const fc_args_t &a) {                                                  \
+    for (int b = 0; b < a.batches; b++) {                                               \
+        int c = 0;                                                                      \
+        for (; c + CHANNEL_BLOCK <= a.output_depth; c += CHANNEL_BLOCK) {               \
+            BLOCK<CHANNEL_BLOCK>(a, b, c);                                              \
+        }                                                                               \
+        for (; c < a.output_depth; c++) {                                               \
+            BLOCK<1>(a, b, c);                                                          \
+        }                                                                               \
+    }                                                                                   \
+}
+
+EI_FC_VNNI_BLOCK(fc_block_avx512vnni, "avx2,avx512f,avx512vl,avx512vnni", _mm256_dpbusd_epi32)
+EI_FC_VNNI(fully_connected_avx512vnni, fc_block_avx512vnni, "avx2,avx512f,avx512vl,avx512vnni")
+
+#if (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11) || (defined(__clang__) && __clang_major__ >= 12)
+#define EI_FC_HAS_AVXVNNI 1
+EI_FC_VNNI_BLOCK(fc_block_avxvnni, "avx2,avxvnni", _mm256_dpbusd_avx_epi32)
+EI_FC_VNNI(fully_connected_avxvnni, fc_block_avxvnni, "avx2,avxvnni")
+#else
+#define EI_FC_HAS_AVXVNNI 0
+#endif
+
+#undef EI_FC_VNNI_BLOCK
+#undef EI_FC_VNNI
+
+enum isa_t {
+    ISA_NONE,
+    ISA_AVX2,
+    ISA_AVXVNNI,
+    ISA_AVX512VNNI,
+};
+
+static inline isa_t detect_isa() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512vl")) {
+        return ISA_AVX512VNNI;
+    }
+#if EI_FC_HAS_AVXVNNI
+    if (__builtin_cpu_supports("avxvnni")) {
+        return ISA_AVXVNNI;
+    }
+#endif
+    if (__builtin_cpu_supports("avx2")) {
+        return ISA_AVX2;
+    }
+    return ISA_NONE;
+}
+
+} // namespace x86
+
+/**
+ * int8 fully connected on `batches` rows of `accum_depth` inputs into
+ * `output_depth` channels. Returns false (and does nothing) when the CPU has
+ * no AVX2, the caller then runs the reference kernel.
+ */
+inline bool FullyConnectedX86(const FullyConnectedParams& params,
+                              int batches,
+                              int output_depth,
+                              int accum_depth,
+                              const int8_t* input_data,
+                              const int8_t* filter_data,
+                              const int32_t* bias_data,
+                              int8_t* output_data) {
+    static const x86::isa_t isa = x86::detect_isa();
+    if (isa == x86::ISA_NONE) {
+        return false;
+    }
+
+    x86::fc_args_t a;
+    a.params = &params;
+    a.batches = batches;
+    a.output_depth = output_depth;
+    a.accum_depth = accum_depth;
+    a.input = input_data;
+    a.filter = filter_data;
+    a.bias = bias_data;
+    a.output = output_data;
+
+    // the VNNI identity needs symmetric weights (always the case for int8 FC)
+    if (params.weights_offset == 0 && isa == x86::ISA_AVX512VNNI) {
+        x86::fully_connected_avx512vnni(a);
+    }
+#if EI_FC_HAS_AVXVNNI
+    else if (params.weights_offset == 0 && isa == x86::ISA_AVXVNNI) {
+        x86::fully_connected_avxvnni(a);
+    }
+#endif
+    else {
+        x86::fully_connected_avx2(a);
+    }
+    return true;
+}
+
+/**
+ * Same, with the arguments of reference_integer_ops::FullyConnected
+ */
+inline bool FullyConnectedX86(const FullyConnectedParams& params,
+                              const RuntimeShape& input_shape,
+                              const int8_t* input_data,
+                              const RuntimeShape& filter_shape,
+                              const int8_t* filter_data,
+                              const RuntimeShape& bias_shape,
+                              const int32_t* bias_data,
+                              const RuntimeShape& output_shape,
+                              int8_t* output_data) {
+    // the sizes all come from the filter and output shapes
+    (void)input_shape;
+    (void)bias_shape;
+    const int filter_dim_count = filter_shape.DimensionsCount();
+    const int output_dim_count = output_shape.DimensionsCount();
+
+    return FullyConnectedX86(params,
+                             FlatSizeSkipDim(output_shape, output_dim_count - 1),
+                             output_shape.Dims(output_dim_count - 1),
+                             filter_shape.Dims(filter_dim_count - 1),
+                             input_data, filter_data, bias_data, output_data);
+}
+
+} // namespace optimized_integer_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FULLY_CONNECTED_X86_H_
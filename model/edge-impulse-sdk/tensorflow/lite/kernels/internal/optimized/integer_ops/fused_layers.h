@@ -0,0 +1,113 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FUSED_LAYERS_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FUSED_LAYERS_H_
+
+// Building blocks for generated code that runs a whole int8 graph in one
+// function (see EI_CLASSIFIER_TFLITE_FUSED_GRAPH): layer shapes are template
+// arguments and quantization parameters come in precomputed, activations
+// live in the caller's buffers instead of the tensor arena. Outputs are
+// bit-exact with the TFLM reference kernels.
+
+#include <algorithm>
+#include <stdint.h>
+
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
+#include "edge-impulse-sdk/tensorflow/lite/kernels/internal/common.h"
+#include "edge-impulse-sdk/tensorflow/lite/kernels/internal/reference/softmax.h"
+#if EI_CLASSIFIER_TFLITE_ENABLE_X86_SIMD == 1
+#include "edge-impulse-sdk/tensorflow/lite/kernels/internal/optimized/integer_ops/fully_connected_x86.h"
+#endif
+
+namespace tflite {
+namespace optimized_integer_ops {
+namespace fused {
+
+/**
+ * int8 fully connected over `batches` rows of kAccumDepth inputs into
+ * kOutputDepth channels, filter laid out [kOutputDepth][kAccumDepth].
+ * Same math as reference_integer_ops::FullyConnected.
+ */
+template<int kAccumDepth, int kOutputDepth>
+inline void FullyConnected(const FullyConnectedParams& params,
+                           int batches,
+                           const int8_t* input,
+                           const int8_t* filter,
+                           const int32_t* bias,
+                           int8_t* output) {
+#if EI_CLASSIFIER_TFLITE_ENABLE_X86_SIMD == 1
+    if (FullyConnectedX86(params, batches, kOutputDepth, kAccumDepth, input, filter, bias, output)) {
+        return;
+    }
+#endif
+
+    for (int b = 0; b < batches; ++b) {
+        const int8_t* x = input + b * kAccumDepth;
+        for (int c = 0; c < kOutputDepth; ++c) {
+            const int8_t* w = filter + c * kAccumDepth;
+            int32_t acc = 0;
+            for (int d = 0; d < kAccumDepth; ++d) {
+                acc += (w[d] + params.weights_offset) * (x[d] + params.input_offset);
+            }
+            if (bias) {
+                acc += bias[c];
+            }
+            acc = MultiplyByQuantizedMultiplier(acc, params.output_multiplier, params.output_shift);
+            acc += params.output_offset;
+            acc = std::max(acc, params.quantized_activation_min);
+            acc = std::min(acc, params.quantized_activation_max);
+            output[b * kOutputDepth + c] = static_cast<int8_t>(acc);
+        }
+    }
+}
+
+/**
+ * int8 -> int8 softmax over `batches` rows of kClasses logits
+ */
+template<int kClasses>
+inline void Softmax(const SoftmaxParams& params,
+                    int batches,
+                    const int8_t* input,
+                    int8_t* output) {
+    const int32_t dims[2] = { batches, kClasses };
+    const RuntimeShape shape(2, dims);
+    reference_ops::Softmax(params, shape, input, shape, output);
+}
+
+} // namespace fused
+} // namespace optimized_integer_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FUSED_LAYERS_H_
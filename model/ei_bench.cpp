@@ -0,0 +1,383 @@
+// Benchmark for the knock impulse. Replays a recorded mic,imu CSV (or a
+// synthetic stream) through the impulse one window at a time and reports
+// latency percentiles for every stage of process_impulse, plus run_classifier
+// as a whole, so regressions show up per stage instead of as one number.
+//
+// The stages are driven the same way process_impulse drives them (DSP blocks
+// in order, data normalization, run_inference, run_postprocessing), and the
+// scores are checked against run_classifier on the same window.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+
+#ifndef EI_BENCH_DEFAULT_CSV
+#define EI_BENCH_DEFAULT_CSV "../collected-data/example_datastream.csv"
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock bench_clock;
+
+uint64_t elapsed_ns(bench_clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench_clock::now() - start).count();
+}
+
+// Latency samples for one stage, in nanoseconds
+struct Stage {
+    explicit Stage(const std::string &name) : name(name) { }
+    std::string name;
+    std::vector<uint64_t> ns;
+};
+
+void print_usage(const char *prog) {
+    std::fprintf(stderr,
+                 "usage: %s [--csv FILE | --synthetic N] [--hop N] [--passes N] [--warmup N]\n"
+                 "  --csv FILE     mic,imu recording to replay (default %s)\n"
+                 "  --synthetic N  generate N samples of noise with periodic knocks instead\n"
+                 "  --hop N        samples between two windows (default 1)\n"
+                 "  --passes N     times to go over all windows (default 3)\n"
+                 "  --warmup N     windows to run before measuring (default 50)\n",
+                 prog, EI_BENCH_DEFAULT_CSV);
+}
+
+bool parse_count(const char *flag, const char *arg, size_t *out) {
+    char *end = nullptr;
+    unsigned long n = std::strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || n == 0) {
+        std::fprintf(stderr, "invalid %s value '%s'\n", flag, arg);
+        return false;
+    }
+    *out = n;
+    return true;
+}
+
+// Same parsing rules as the ei_infer text path: header, comments and
+// malformed lines are skipped, only the imu column is kept
+bool load_csv(const char *path, std::vector<float> *imu) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t comma = line.find(',');
+        if (comma == std::string::npos) {
+            continue;
+        }
+        const char *field = line.c_str() + comma + 1;
+        char *end = nullptr;
+        float v = std::strtof(field, &end);
+        if (end == field) {
+            continue;
+        }
+        imu->push_back(v);
+    }
+    return true;
+}
+
+// Low-level sensor noise with a decaying ~60 Hz burst every 1.5 seconds,
+// roughly what a knock looks like on the IMU channel
+void make_synthetic(size_t samples, float frequency, std::vector<float> *imu) {
+    srand(1);
+    const size_t period = (size_t)(frequency * 1.5f);
+    for (size_t ix = 0; ix < samples; ix++) {
+        float v = 4.2f + ((float)rand() / RAND_MAX - 0.5f) * 0.02f;
+        size_t t = ix % period;
+        if (ix >= period && t < (size_t)(frequency * 0.2f)) {
+            float secs = t / frequency;
+            v += 1.5f * std::exp(-secs * 25.0f) * std::sin(2.0f * (float)M_PI * 60.0f * secs);
+        }
+        imu->push_back(v);
+    }
+}
+
+const char *dsp_block_name(const ei_model_dsp_t &block) {
+    if (block.extract_fn == &extract_spectrogram_features) {
+        return "extract_spectrogram_features";
+    }
+    if (block.extract_fn == &extract_spectral_analysis_features) {
+        return "extract_spectral_analysis_features";
+    }
+    return nullptr;
+}
+
+// One window through the impulse stage by stage, mirroring process_impulse.
+// stage_ns gets one entry per DSP block, then normalization, inference and
+// postprocessing.
+EI_IMPULSE_ERROR run_stages(ei_impulse_handle_t *handle, signal_t *signal,
+                            ei_impulse_result_t *result,
+                            ei_impulse_result_classification_t *classification,
+                            ei_feature_t *raw_outputs, uint64_t *stage_ns) {
+    const ei_impulse_t *impulse = handle->impulse;
+
+    memset(result, 0, sizeof(*result));
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    for (size_t ix = 0; ix < impulse->label_count; ix++) {
+        classification[ix].label = impulse->categories[ix];
+        classification[ix].value = 0.0f;
+    }
+    result->classification = classification;
+#else
+    (void)classification;
+#endif
+    memset(raw_outputs, 0, sizeof(ei_feature_t) * impulse->output_tensors_size);
+    result->_raw_outputs = raw_outputs;
+
+    const size_t block_num = impulse->dsp_blocks_size;
+    std::unique_ptr<ei_feature_t[]> features(new ei_feature_t[block_num]);
+    std::unique_ptr<std::unique_ptr<ei::matrix_t>[]> matrices(new std::unique_ptr<ei::matrix_t>[block_num]);
+    memset(features.get(), 0, sizeof(ei_feature_t) * block_num);
+
+    size_t stage = 0;
+    for (size_t ix = 0; ix < block_num; ix++) {
+        ei_model_dsp_t block = impulse->dsp_blocks[ix];
+
+        bench_clock::time_point start = bench_clock::now();
+
+        matrices[ix].reset(new ei::matrix_t(1, block.n_output_features));
+        features[ix].matrix = matrices[ix].get();
+        features[ix].blockId = block.blockId;
+
+        SignalWithAxes swa(signal, block.axes, block.axes_size, impulse);
+
+        int ret;
+        if (block.factory) {
+            auto dsp_handle = handle->state.get_dsp_handle(ix);
+            if (!dsp_handle) {
+                return EI_IMPULSE_OUT_OF_MEMORY;
+            }
+            ret = dsp_handle->extract(swa.get_signal(), features[ix].matrix, block.config,
+                                      impulse->frequency, result);
+        }
+        else {
+            ret = block.extract_fn(swa.get_signal(), features[ix].matrix, block.config,
+                                   impulse->frequency);
+        }
+        stage_ns[stage++] = elapsed_ns(start);
+
+        if (ret != EIDSP_OK) {
+            ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
+            return EI_IMPULSE_DSP_ERROR;
+        }
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+#if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
+    EI_IMPULSE_ERROR res = run_data_normalization(handle, features.get());
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
+#endif
+    stage_ns[stage++] = elapsed_ns(start);
+
+    start = bench_clock::now();
+    EI_IMPULSE_ERROR inf = run_inference(handle, features.get(), result, false);
+    stage_ns[stage++] = elapsed_ns(start);
+    if (inf != EI_IMPULSE_OK) {
+        return inf;
+    }
+
+    start = bench_clock::now();
+    EI_IMPULSE_ERROR post = run_postprocessing(handle, result);
+    stage_ns[stage++] = elapsed_ns(start);
+    return post;
+}
+
+// Nearest-rank percentile of a sorted vector
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    if (rank == 0) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+void print_stage(Stage *stage) {
+    std::vector<uint64_t> &v = stage->ns;
+    std::sort(v.begin(), v.end());
+    double sum = 0;
+    for (size_t ix = 0; ix < v.size(); ix++) {
+        sum += v[ix];
+    }
+    const double mean = v.empty() ? 0 : sum / v.size();
+    std::printf("%-38s %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                stage->name.c_str(), mean / 1e3,
+                percentile(v, 50) / 1e3, percentile(v, 95) / 1e3,
+                percentile(v, 99) / 1e3, (v.empty() ? 0 : v.back()) / 1e3);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *csv_path = EI_BENCH_DEFAULT_CSV;
+    size_t synthetic = 0;
+    size_t hop = 1;
+    size_t passes = 3;
+    size_t warmup = 50;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) {
+            if (!parse_count("--synthetic", argv[++i], &synthetic)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--hop") == 0 && i + 1 < argc) {
+            if (!parse_count("--hop", argv[++i], &hop)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--passes") == 0 && i + 1 < argc) {
+            if (!parse_count("--passes", argv[++i], &passes)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            char *end = nullptr;
+            warmup = std::strtoul(argv[++i], &end, 10);
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ei_impulse_handle_t *handle = &ei_default_impulse;
+    const ei_impulse_t *impulse = handle->impulse;
+
+    // run_classifier gets its own handle: stateful DSP blocks (the spectrogram
+    // frame cache) would otherwise find every window already done by the
+    // staged run and time nothing
+    ei_impulse_handle_t reference(impulse);
+    const size_t window_size = EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE;
+
+    std::vector<float> imu;
+    if (synthetic > 0) {
+        make_synthetic(synthetic, EI_CLASSIFIER_FREQUENCY, &imu);
+    }
+    else if (!load_csv(csv_path, &imu)) {
+        std::fprintf(stderr, "cannot read %s\n", csv_path);
+        return 1;
+    }
+    if (imu.size() < window_size) {
+        std::fprintf(stderr, "need at least %lu samples, got %lu\n",
+                     (unsigned long)window_size, (unsigned long)imu.size());
+        return 1;
+    }
+
+    std::vector<Stage> stages;
+    for (size_t ix = 0; ix < impulse->dsp_blocks_size; ix++) {
+        const char *name = dsp_block_name(impulse->dsp_blocks[ix]);
+        char buf[64];
+        if (!name) {
+            std::snprintf(buf, sizeof(buf), "dsp block %u", (unsigned)impulse->dsp_blocks[ix].blockId);
+            name = buf;
+        }
+        stages.push_back(Stage(name));
+    }
+    stages.push_back(Stage("data normalization"));
+    stages.push_back(Stage("run_inference (NN invoke)"));
+    stages.push_back(Stage("run_postprocessing"));
+    Stage staged_total("total (staged)");
+    Stage classifier_total("run_classifier");
+
+    std::vector<uint64_t> stage_ns(stages.size());
+    std::vector<ei_impulse_result_classification_t> classification(impulse->label_count);
+    std::unique_ptr<ei_feature_t[]> raw_outputs(new ei_feature_t[impulse->output_tensors_size]);
+
+    const size_t windows = (imu.size() - window_size) / hop + 1;
+    size_t mismatches = 0;
+
+    for (size_t ix = 0; ix < warmup; ix++) {
+        signal_t signal;
+        numpy::signal_from_buffer(&imu[(ix % windows) * hop], window_size, &signal);
+        ei_impulse_result_t result;
+        run_classifier(&signal, &result, false);
+    }
+
+    bench_clock::time_point bench_start = bench_clock::now();
+
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (size_t wx = 0; wx < windows; wx++) {
+            signal_t signal;
+            numpy::signal_from_buffer(&imu[wx * hop], window_size, &signal);
+
+            ei_impulse_result_t staged;
+            bench_clock::time_point start = bench_clock::now();
+            EI_IMPULSE_ERROR err = run_stages(handle, &signal, &staged, classification.data(),
+                                              raw_outputs.get(), stage_ns.data());
+            staged_total.ns.push_back(elapsed_ns(start));
+            if (err != EI_IMPULSE_OK) {
+                std::fprintf(stderr, "ERR: window %lu failed (%d)\n", (unsigned long)wx, err);
+                return 1;
+            }
+            for (size_t sx = 0; sx < stages.size(); sx++) {
+                stages[sx].ns.push_back(stage_ns[sx]);
+            }
+
+            ei_impulse_result_t result;
+            start = bench_clock::now();
+            err = process_impulse(&reference, &signal, &result, false);
+            classifier_total.ns.push_back(elapsed_ns(start));
+            if (err != EI_IMPULSE_OK) {
+                std::fprintf(stderr, "ERR: run_classifier on window %lu failed (%d)\n",
+                             (unsigned long)wx, err);
+                return 1;
+            }
+
+            for (size_t lx = 0; lx < impulse->label_count; lx++) {
+                if (result.classification[lx].value != staged.classification[lx].value) {
+                    mismatches++;
+                    break;
+                }
+            }
+        }
+    }
+
+    const double bench_s = elapsed_ns(bench_start) / 1e9;
+    const size_t measured = classifier_total.ns.size();
+
+    std::printf("ei_bench: %s, %lu samples, window %lu, hop %lu, %lu windows x %lu passes\n",
+                synthetic > 0 ? "synthetic" : csv_path, (unsigned long)imu.size(),
+                (unsigned long)window_size, (unsigned long)hop,
+                (unsigned long)windows, (unsigned long)passes);
+    std::printf("\n%-38s %9s %9s %9s %9s %9s\n", "stage (us)", "mean", "p50", "p95", "p99", "max");
+    for (size_t sx = 0; sx < stages.size(); sx++) {
+        print_stage(&stages[sx]);
+    }
+    print_stage(&staged_total);
+    print_stage(&classifier_total);
+
+    double classifier_sum = 0;
+    for (size_t ix = 0; ix < measured; ix++) {
+        classifier_sum += classifier_total.ns[ix];
+    }
+    const double per_core = classifier_sum > 0 ? measured / (classifier_sum / 1e9) : 0;
+    const double window_s = window_size / (double)EI_CLASSIFIER_FREQUENCY;
+    std::printf("\nrun_classifier: %.0f windows/s per core (%.1f streams at hop %lu)\n",
+                per_core, per_core * hop / EI_CLASSIFIER_FREQUENCY, (unsigned long)hop);
+    std::printf("window length %.2f s, wall time %.2f s\n", window_s, bench_s);
+
+    if (mismatches > 0) {
+        std::printf("WARN: %lu windows where the staged scores differ from run_classifier\n",
+                    (unsigned long)mismatches);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef EI_INFER_PROTOCOL_H
+#define EI_INFER_PROTOCOL_H
+
+#include <stdint.h>
+
+// Binary framing used by `ei_infer --binary`. Everything is little-endian,
+// fixed-size and unpadded, so a feeder can push a whole batch of samples with
+// a single write() and read any number of results with a single read().
+//
+//   ei_infer -> feeder   one ei_infer_header_t, followed by label_count
+//                        label names of EI_INFER_LABEL_LEN bytes each
+//                        (NUL padded), then a stream of result records
+//   feeder -> ei_infer   a stream of ei_infer_sample_t records
+//
+// A result record is an ei_infer_result_t followed by label_count float
+// scores, in the same order as the label names in the header.
+//
+// With `--streams N` the samples and results carry a stream id (0..N-1)
+// instead: ei_infer_stream_sample_t in, ei_infer_stream_result_t + scores out.
+//
+// With `--events` the header carries EI_INFER_EVENT_MAGIC and the result
+// records are replaced by ei_infer_event_t records, one per event start/end.
+
+#define EI_INFER_MAGIC          0x4e4b4945u // "EIKN" on the wire
+#define EI_INFER_EVENT_MAGIC    0x56454945u // "EIEV" on the wire
+#define EI_INFER_VERSION        1
+#define EI_INFER_LABEL_LEN      32
+
+#pragma pack(push, 1)
+
+typedef struct {
+    uint32_t magic;         // EI_INFER_MAGIC
+    uint16_t version;       // EI_INFER_VERSION
+    uint16_t label_count;   // number of scores in every result record
+    uint32_t window_size;   // samples per classified window
+    uint32_t hop;           // samples between two results
+} ei_infer_header_t;
+
+typedef struct {
+    float mic;              // parsed but unused by the model
+    float imu;
+} ei_infer_sample_t;
+
+typedef struct {
+    uint64_t sample_index;  // number of samples ingested when this window closed
+    uint32_t dsp_us;        // dsp_us and classification_us are 0 for quiet
+    uint32_t classification_us; // windows answered by --gate
+    // followed by float scores[label_count]
+} ei_infer_result_t;
+
+typedef struct {
+    uint32_t stream_id;
+    float mic;
+    float imu;
+} ei_infer_stream_sample_t;
+
+typedef struct {
+    uint32_t stream_id;
+    uint64_t sample_index;  // samples ingested on this stream when the window closed
+    uint32_t dsp_us;
+    uint32_t classification_us;
+    // followed by float scores[label_count]
+} ei_infer_stream_result_t;
+
+#define EI_INFER_EVENT_START    1
+#define EI_INFER_EVENT_END      2
+
+typedef struct {
+    uint8_t type;           // EI_INFER_EVENT_START or EI_INFER_EVENT_END
+    uint8_t label;          // index into the label names from the header
+    uint16_t reserved;
+    uint64_t sample_index;  // samples ingested when the start / end window closed
+    uint64_t start_index;   // samples ingested when the first hit window closed
+    float score;            // score that started the event, peak score on end
+} ei_infer_event_t;
+
+#pragma pack(pop)
+
+#endif // EI_INFER_PROTOCOL_H
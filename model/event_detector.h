@@ -0,0 +1,143 @@
+#ifndef EVENT_DETECTOR_H
+#define EVENT_DETECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cctype>
+#include <cstdio>
+
+// Turns the per-window score of one label into start/end events.
+//
+// ei_classifier_smooth_t votes over the last N readings of all labels, which
+// still reports once per window and has no notion of an event ending. This
+// keeps the same "don't trust a single reading" idea for one label, with:
+//  - threshold: a window counts as a hit when score >= threshold
+//  - min_consecutive: hits needed in a row before an event starts
+//  - release: the event ends on the first window with score < release
+//    (release <= threshold, so the score can dip a bit without ending it)
+//  - refractory: samples after an event ends during which no new event can
+//    start, so one physical knock sliding through the window fires once
+class EventDetector {
+public:
+    enum Type {
+        NONE = 0,
+        START = 1,
+        END = 2
+    };
+
+    struct Event {
+        Type type;
+        uint64_t sample_index;  // window that triggered the start / end
+        uint64_t start_index;   // first hit window of this event
+        float score;            // score at start, peak score at end
+    };
+
+    EventDetector(float threshold, float release, size_t min_consecutive, uint64_t refractory)
+        : threshold_(threshold)
+        , release_(release < threshold ? release : threshold)
+        , min_consecutive_(min_consecutive > 0 ? min_consecutive : 1)
+        , refractory_(refractory)
+    {
+        reset();
+    }
+
+    void reset() {
+        active_ = false;
+        hits_ = 0;
+        first_hit_ = 0;
+        peak_ = 0.0f;
+        blocked_until_ = 0;
+    }
+
+    bool active() const { return active_; }
+
+    // Feed the score of the window ending at sample_index. Returns true and
+    // fills `event` when an event starts or ends on this window.
+    bool update(float score, uint64_t sample_index, Event *event) {
+        if (active_) {
+            if (score > peak_) {
+                peak_ = score;
+            }
+            if (score >= release_) {
+                return false;
+            }
+            end(sample_index, event);
+            return true;
+        }
+
+        if (score < threshold_ || sample_index < blocked_until_) {
+            hits_ = 0;
+            return false;
+        }
+
+        if (hits_++ == 0) {
+            first_hit_ = sample_index;
+            peak_ = score;
+        }
+        else if (score > peak_) {
+            peak_ = score;
+        }
+        if (hits_ < min_consecutive_) {
+            return false;
+        }
+
+        active_ = true;
+        event->type = START;
+        event->sample_index = sample_index;
+        event->start_index = first_hit_;
+        event->score = score;
+        return true;
+    }
+
+    // Close a still open event at end of stream. Returns false if none was open.
+    bool flush(uint64_t sample_index, Event *event) {
+        if (!active_) {
+            return false;
+        }
+        end(sample_index, event);
+        return true;
+    }
+
+private:
+    void end(uint64_t sample_index, Event *event) {
+        event->type = END;
+        event->sample_index = sample_index;
+        event->start_index = first_hit_;
+        event->score = peak_;
+
+        active_ = false;
+        hits_ = 0;
+        blocked_until_ = sample_index + refractory_;
+    }
+
+    const float threshold_;
+    const float release_;
+    const size_t min_consecutive_;
+    const uint64_t refractory_;
+
+    bool active_;
+    size_t hits_;
+    uint64_t first_hit_;
+    float peak_;
+    uint64_t blocked_until_;
+};
+
+// Text form of an event, e.g. "KNOCK start sample=1200 first=1150 score=0.943",
+// followed by `suffix` (e.g. " conn=3") and a newline
+static inline void print_event(FILE *out, const char *label, const EventDetector::Event &event,
+                               const char *suffix) {
+    char name[32] = {0};
+    for (size_t ix = 0; ix < sizeof(name) - 1 && label[ix]; ix++) {
+        name[ix] = (char)std::toupper((unsigned char)label[ix]);
+    }
+    std::fprintf(out, "%s %s sample=%llu first=%llu %s=%.3f%s\n", name,
+                 event.type == EventDetector::START ? "start" : "end",
+                 (unsigned long long)event.sample_index,
+                 (unsigned long long)event.start_index,
+                 event.type == EventDetector::START ? "score" : "peak",
+                 event.score, suffix);
+    std::fflush(out);
+}
+
+#endif // EVENT_DETECTOR_H
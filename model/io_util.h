@@ -0,0 +1,22 @@
+#ifndef IO_UTIL_H
+#define IO_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// Write the whole buffer, retrying on short writes
+static inline bool write_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+#endif // IO_UTIL_H
@@ -1,71 +1,784 @@
+#include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/ioctl.h>
+#endif
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "activity_gate.h"
+#include "batch_eval.h"
+#include "ei_infer_protocol.h"
+#include "event_detector.h"
+#include "io_util.h"
+#include "metrics.h"
+#include "multi_stream.h"
+#include "ring_window.h"
+#ifndef _WIN32
+#include "shm_ring.h"
+#endif
+#ifdef __linux__
+#include "ws_ingest.h"
+#endif
 
-int main() {
-    // We only use IMU values as model input
-    constexpr size_t AXES = 1;
+// Where SDK and diagnostic output goes. stdout in text mode (as before), but
+// in binary mode stdout carries the result stream, so this moves to stderr.
+static FILE *log_stream = stdout;
 
-    const size_t window_size = EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE;
-    static float window[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE] = {0};
+// Overrides the weak posix implementation so ei_printf follows log_stream
+void ei_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    std::vfprintf(log_stream, format, args);
+    va_end(args);
+}
 
-    auto push_sample = [&](float imu) {
-        // shift left by 1 value
-        memmove(window,
-                window + AXES,
-                sizeof(float) * (window_size - AXES));
+static void print_usage(const char *prog) {
+    std::fprintf(stderr,
+                 "usage: %s [--hop N|slice | --continuous] [--binary] [--streams N | --eval FILE] [--threads N]\n"
+                 "          [--shm NAME [--shm-capacity N]] [--ws PORT]\n"
+                 "          [--stats SECONDS] [--metrics-socket PATH] [--gate FLOOR [--gate-variance X]]\n"
+                 "          [--events [--label NAME] [--threshold X] [--release X]\n"
+                 "                    [--min-consecutive N] [--refractory N]]\n"
+                 "  --hop N      classify every N samples once the window is full (default 1)\n"
+                 "  --hop slice  classify once per model slice (%d samples)\n"
+                 "  --continuous classify once per slice with run_classifier_continuous, DSP runs\n"
+                 "               on the new slice only where the blocks allow it\n"
+                 "  --binary     framed binary records on stdin/stdout (see ei_infer_protocol.h)\n"
+                 "  --streams N  serve stream ids 0..N-1 from one process (implies --binary)\n"
+                 "  --eval FILE  score a recorded mic,imu CSV offline, predictions as CSV on stdout\n"
+                 "  --threads N  worker threads for --streams and --eval (default: all cores)\n"
+                 "  --shm NAME   take binary sample records from the shared-memory ring NAME\n"
+                 "               (see shm_ring.h) instead of stdin, implies --binary\n"
+                 "    --shm-capacity N      ring size in records (default 65536)\n"
+                 "  --ws PORT    accept the device firmware directly on ws://0.0.0.0:PORT/ws,\n"
+                 "               one window per connection, text output (Linux only)\n"
+                 "  --stats SECONDS        counters and latency percentiles on stderr every SECONDS\n"
+                 "  --metrics-socket PATH  serve all metrics (Prometheus text format) on a unix socket\n"
+                 "  --gate FLOOR skip the impulse on windows where every hop has an IMU peak-to-peak\n"
+                 "               below FLOOR, reporting the last quiet window's result instead;\n"
+                 "               only quiet windows below --threshold on --label are reused\n"
+                 "               (not with --continuous, --streams, --eval or --ws)\n"
+                 "    --gate-variance X     a hop with IMU variance >= X is active too (default: off)\n"
+                 "  --events     only report start/end of events on one label instead of every window\n"
+                 "    --label NAME          label to watch (default knock)\n"
+                 "    --threshold X         score that counts as a hit (default 0.9)\n"
+                 "    --release X           event ends when the score drops below this (default 0.5)\n"
+                 "    --min-consecutive N   hits in a row before an event starts (default 2)\n"
+                 "    --refractory N        samples after an event before the next can start (default %d)\n",
+                 prog, (int)EI_CLASSIFIER_SLICE_SIZE, (int)EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE / 2);
+}
 
-        // append imu at end
-        window[window_size - 1] = imu;
-    };
+static bool parse_count(const char *flag, const char *arg, size_t *out) {
+    char *end = nullptr;
+    unsigned long n = std::strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || n == 0) {
+        std::fprintf(stderr, "invalid %s value '%s'\n", flag, arg);
+        return false;
+    }
+    *out = n;
+    return true;
+}
 
-    // Wrap the buffer in a signal_t once
+// Parse a score between 0 and 1
+static bool parse_score(const char *flag, const char *arg, float *out) {
+    char *end = nullptr;
+    float v = std::strtof(arg, &end);
+    if (end == arg || *end != '\0' || v < 0.0f || v > 1.0f) {
+        std::fprintf(stderr, "invalid %s value '%s'\n", flag, arg);
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+// Parse an IMU level, `allow_zero` for floors where 0 turns the check off
+static bool parse_level(const char *flag, const char *arg, bool allow_zero, float *out) {
+    char *end = nullptr;
+    float v = std::strtof(arg, &end);
+    if (end == arg || *end != '\0' || !(v >= 0.0f) || (v == 0.0f && !allow_zero)) {
+        std::fprintf(stderr, "invalid %s value '%s'\n", flag, arg);
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+// Header and label names, written once at the start of a binary session
+static bool write_binary_header(uint32_t magic, size_t window_size, size_t hop) {
+    const size_t label_count = EI_CLASSIFIER_LABEL_COUNT;
+
+    std::vector<uint8_t> out;
+    out.reserve(sizeof(ei_infer_header_t) + label_count * EI_INFER_LABEL_LEN);
+
+    ei_infer_header_t header;
+    header.magic = magic;
+    header.version = EI_INFER_VERSION;
+    header.label_count = (uint16_t)label_count;
+    header.window_size = (uint32_t)window_size;
+    header.hop = (uint32_t)hop;
+    out.insert(out.end(), (uint8_t *)&header, (uint8_t *)&header + sizeof(header));
+    for (size_t ix = 0; ix < label_count; ix++) {
+        char name[EI_INFER_LABEL_LEN] = {0};
+        std::strncpy(name, ei_classifier_inferencing_categories[ix], EI_INFER_LABEL_LEN - 1);
+        out.insert(out.end(), (uint8_t *)name, (uint8_t *)name + EI_INFER_LABEL_LEN);
+    }
+    return write_all(STDOUT_FILENO, out.data(), out.size());
+}
+
+#ifndef _WIN32
+// Set with --shm, records then come from the shared-memory ring instead of stdin
+static ShmRing *shm_input = nullptr;
+#endif
+
+// When the input currently being processed arrived, for the end-to-end latency
+static uint64_t input_arrival_us = 0;
+
+// Unread bytes left on the input after a read, for the backlog gauge
+static void update_input_backlog() {
+#ifndef _WIN32
+    if (shm_input) {
+        metrics.input_backlog_bytes.store(shm_input->pending_bytes(), std::memory_order_relaxed);
+        return;
+    }
+    int pending = 0;
+    if (ioctl(STDIN_FILENO, FIONREAD, &pending) == 0) {
+        metrics.input_backlog_bytes.store((uint64_t)pending, std::memory_order_relaxed);
+    }
+#endif
+}
+
+static ssize_t read_input(void *buf, size_t len) {
+    ssize_t n;
+#ifndef _WIN32
+    if (shm_input) {
+        n = (ssize_t)shm_input->read(buf, len);
+    }
+    else
+#endif
+    {
+        n = read(STDIN_FILENO, buf, len);
+    }
+    input_arrival_us = ei_read_timer_us();
+    update_input_backlog();
+    return n;
+}
+
+// Read fixed-size records from the input until EOF. Calls on_record for
+// every complete record and on_chunk after each read() has been consumed.
+// Records come in whatever chunks the feeder wrote them in, so one may
+// straddle two reads; the partial tail is kept around for the next read.
+template <typename Record, typename OnRecord, typename OnChunk>
+static void read_records(OnRecord on_record, OnChunk on_chunk) {
+    static uint8_t in[4096 * sizeof(Record)];
+    size_t in_len = 0;
+
+    while (true) {
+        ssize_t n = read_input(in + in_len, sizeof(in) - in_len);
+        if (n <= 0) {
+            break;
+        }
+        in_len += (size_t)n;
+
+        const size_t records = in_len / sizeof(Record);
+        for (size_t ix = 0; ix < records; ix++) {
+            Record rec;
+            memcpy(&rec, in + ix * sizeof(Record), sizeof(rec));
+            on_record(rec);
+        }
+
+        if (!on_chunk()) {
+            break;
+        }
+
+        const size_t consumed = records * sizeof(Record);
+        memmove(in, in + consumed, in_len - consumed);
+        in_len -= consumed;
+    }
+}
+
+// Each thread classifies through its own impulse handle (DSP state and result
+// buffers; the compiled model gets an instance per inference), so the workers
+// run in parallel
+static ei_impulse_handle_t &thread_impulse() {
+    static thread_local ei_impulse_handle_t handle(ei_default_impulse.impulse);
+    return handle;
+}
+
+// Classify one contiguous window, used by the --ws path
+static bool classify_window(const float *window, size_t window_size,
+                            uint32_t *dsp_us, uint32_t *classification_us,
+                            float *scores) {
     signal_t signal;
-    int err = numpy::signal_from_buffer(window, window_size, &signal);
-    if (err != 0) {
-        ei_printf("signal_from_buffer failed (%d)\n", err);
+    numpy::signal_from_buffer(window, window_size, &signal);
+
+    ei_impulse_result_t result;
+    EI_IMPULSE_ERROR ei_err = run_classifier(&thread_impulse(), &signal, &result, false);
+    if (ei_err != EI_IMPULSE_OK) {
+        metrics.classify_errors.fetch_add(1, std::memory_order_relaxed);
+        ei_printf("ERR: run_classifier (%d)\n", ei_err);
+        return false;
+    }
+
+    *dsp_us = (uint32_t)result.timing.dsp_us;
+    *classification_us = (uint32_t)result.timing.classification_us;
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        scores[ix] = result.classification[ix].value;
+    }
+    return true;
+}
+
+// Classify several windows with one run of the network, used by the
+// multi-stream and --eval paths
+static bool classify_windows(const float *windows, size_t count, size_t window_size,
+                             uint32_t *dsp_us, uint32_t *classification_us,
+                             float *scores) {
+    std::vector<signal_t> signals(count);
+    for (size_t ix = 0; ix < count; ix++) {
+        numpy::signal_from_buffer(windows + ix * window_size, window_size, &signals[ix]);
+    }
+    std::vector<ei_impulse_result_t> results(count);
+
+    EI_IMPULSE_ERROR ei_err = run_classifier_batch(&thread_impulse(), signals.data(), count, results.data(), false);
+    if (ei_err != EI_IMPULSE_OK) {
+        metrics.classify_errors.fetch_add(count, std::memory_order_relaxed);
+        ei_printf("ERR: run_classifier_batch (%d)\n", ei_err);
+        return false;
+    }
+
+    for (size_t ix = 0; ix < count; ix++) {
+        dsp_us[ix] = (uint32_t)results[ix].timing.dsp_us;
+        classification_us[ix] = (uint32_t)results[ix].timing.classification_us;
+        for (size_t lx = 0; lx < EI_CLASSIFIER_LABEL_COUNT; lx++) {
+            scores[ix * EI_CLASSIFIER_LABEL_COUNT + lx] = results[ix].classification[lx].value;
+        }
+    }
+    return true;
+}
+
+#ifdef __linux__
+// Set by SIGINT / SIGTERM to stop the --ws server loop
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int) {
+    stop_requested = 1;
+}
+#endif
+
+int main(int argc, char **argv) {
+    // Number of new samples between two classifications. The window still
+    // slides by one sample at a time, we just don't run the impulse on all
+    // of the (almost identical) intermediate windows.
+    size_t hop = 1;
+    bool binary = false;
+    bool continuous = false;
+    size_t streams = 0;
+    const char *eval_path = nullptr;
+    const char *shm_name = nullptr;
+    size_t ws_port = 0;
+    size_t stats_interval = 0;
+    const char *metrics_socket = nullptr;
+    size_t shm_capacity = 65536;
+    bool events = false;
+    const char *event_label = "knock";
+    float threshold = 0.9f;
+    float release = 0.5f;
+    size_t min_consecutive = 2;
+    size_t refractory = EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE / 2;
+    float gate_floor = 0.0f;
+    float gate_variance = 0.0f;
+    size_t threads = std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--hop") == 0 && i + 1 < argc) {
+            const char *arg = argv[++i];
+            if (std::strcmp(arg, "slice") == 0) {
+                hop = EI_CLASSIFIER_SLICE_SIZE;
+            }
+            else if (!parse_count("--hop", arg, &hop)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--continuous") == 0) {
+            continuous = true;
+        }
+        else if (std::strcmp(argv[i], "--binary") == 0) {
+            binary = true;
+        }
+        else if (std::strcmp(argv[i], "--streams") == 0 && i + 1 < argc) {
+            if (!parse_count("--streams", argv[++i], &streams)) {
+                return 1;
+            }
+            binary = true;
+        }
+        else if (std::strcmp(argv[i], "--eval") == 0 && i + 1 < argc) {
+            eval_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_name = argv[++i];
+            binary = true;
+        }
+        else if (std::strcmp(argv[i], "--shm-capacity") == 0 && i + 1 < argc) {
+            if (!parse_count("--shm-capacity", argv[++i], &shm_capacity)) {
+                return 1;
+            }
+#ifndef _WIN32
+            if (shm_capacity > SHM_RING_MAX_CAPACITY) {
+                std::fprintf(stderr, "--shm-capacity can be at most %lu\n",
+                             (unsigned long)SHM_RING_MAX_CAPACITY);
+                return 1;
+            }
+#endif
+        }
+        else if (std::strcmp(argv[i], "--ws") == 0 && i + 1 < argc) {
+            if (!parse_count("--ws", argv[++i], &ws_port) || ws_port > 65535) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            if (!parse_count("--stats", argv[++i], &stats_interval)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--metrics-socket") == 0 && i + 1 < argc) {
+            metrics_socket = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--events") == 0) {
+            events = true;
+        }
+        else if (std::strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            event_label = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            if (!parse_score("--threshold", argv[++i], &threshold)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--release") == 0 && i + 1 < argc) {
+            if (!parse_score("--release", argv[++i], &release)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--min-consecutive") == 0 && i + 1 < argc) {
+            if (!parse_count("--min-consecutive", argv[++i], &min_consecutive)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--refractory") == 0 && i + 1 < argc) {
+            char *end = nullptr;
+            const char *arg = argv[++i];
+            refractory = std::strtoul(arg, &end, 10);
+            if (end == arg || *end != '\0') {
+                std::fprintf(stderr, "invalid --refractory value '%s'\n", arg);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--gate") == 0 && i + 1 < argc) {
+            if (!parse_level("--gate", argv[++i], false, &gate_floor)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--gate-variance") == 0 && i + 1 < argc) {
+            if (!parse_level("--gate-variance", argv[++i], true, &gate_variance)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!parse_count("--threads", argv[++i], &threads)) {
+                return 1;
+            }
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    // We only use IMU values as model input, so one value per sample
+    const size_t window_size = EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE;
+
+    if (hop > window_size) {
+        std::fprintf(stderr, "--hop %lu is larger than the window (%lu samples)\n",
+                     (unsigned long)hop, (unsigned long)window_size);
+        return 1;
+    }
+
+    if (continuous) {
+        if (streams > 0 || eval_path || ws_port > 0) {
+            std::fprintf(stderr, "--continuous doesn't work with --streams, --eval or --ws\n");
+            return 1;
+        }
+        hop = EI_CLASSIFIER_SLICE_SIZE;
+    }
+
+    // the gate follows one sliding window, the SDK keeps its own with --continuous
+    const bool gating = gate_floor > 0.0f;
+    if (gating && (continuous || streams > 0 || eval_path || ws_port > 0)) {
+        std::fprintf(stderr, "--gate doesn't work with --continuous, --streams, --eval or --ws\n");
+        return 1;
+    }
+
+    // index of the label --events and --gate watch
+    size_t event_ix = 0;
+    if (events && (streams > 0 || eval_path)) {
+        std::fprintf(stderr, "--events doesn't work with --streams or --eval\n");
+        return 1;
+    }
+    if (events || gating) {
+        while (event_ix < EI_CLASSIFIER_LABEL_COUNT &&
+               std::strcmp(ei_classifier_inferencing_categories[event_ix], event_label) != 0) {
+            event_ix++;
+        }
+        if (event_ix == EI_CLASSIFIER_LABEL_COUNT) {
+            std::fprintf(stderr, "--label: the model has no label '%s'\n", event_label);
+            return 1;
+        }
+    }
+
+    MetricsReporter reporter;
+    if (!reporter.start(stats_interval, metrics_socket)) {
+        return 1;
+    }
+
+    if (ws_port > 0) {
+        if (binary || eval_path) {
+            std::fprintf(stderr, "--ws can't be combined with --binary, --streams, --shm or --eval\n");
+            return 1;
+        }
+#ifdef __linux__
+        WsIngestConfig config;
+        config.window_size = window_size;
+        config.hop = hop;
+        config.labels = ei_classifier_inferencing_categories;
+        config.label_count = EI_CLASSIFIER_LABEL_COUNT;
+        config.events = events;
+        config.event_ix = event_ix;
+        config.threshold = threshold;
+        config.release = release;
+        config.min_consecutive = min_consecutive;
+        config.refractory = refractory;
+
+        ::signal(SIGINT, on_stop_signal);
+        ::signal(SIGTERM, on_stop_signal);
+        ::signal(SIGPIPE, SIG_IGN);
+        return serve_websocket((uint16_t)ws_port, "/ws", config, &classify_window, &stop_requested);
+#else
+        std::fprintf(stderr, "--ws is only supported on Linux\n");
+        return 1;
+#endif
+    }
+
+    if (eval_path) {
+        if (binary) {
+            std::fprintf(stderr, "--eval can't be combined with --binary, --streams or --shm\n");
+            return 1;
+        }
+        // stdout is the prediction CSV
+        log_stream = stderr;
+        return batch_eval(eval_path, window_size, hop, threads,
+                          ei_classifier_inferencing_categories, EI_CLASSIFIER_LABEL_COUNT,
+                          EI_CLASSIFIER_FREQUENCY, &classify_windows);
+    }
+
+    if (binary) {
+        log_stream = stderr;
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        if (!write_binary_header(events ? EI_INFER_EVENT_MAGIC : EI_INFER_MAGIC, window_size, hop)) {
+            return 1;
+        }
+    }
+
+#ifndef _WIN32
+    // same records as on stdin, so the ingest loops below don't change
+    ShmRing shm;
+    if (shm_name) {
+        const uint32_t record_size = streams > 0 ? sizeof(ei_infer_stream_sample_t)
+                                                 : sizeof(ei_infer_sample_t);
+        if (!shm.create(shm_name, record_size, (uint32_t)shm_capacity)) {
+            ei_printf("ERR: cannot create shared-memory ring %s\n", shm_name);
+            return 1;
+        }
+        shm_input = &shm;
+        ei_printf("ei_stdin_infer: reading samples from shared-memory ring %s (%lu records)\n",
+                  shm_name, (unsigned long)shm_capacity);
+    }
+#else
+    if (shm_name) {
+        std::fprintf(stderr, "--shm is not supported on Windows\n");
         return 1;
     }
+#endif
+
+    if (streams > 0) {
+        ei_printf("ei_stdin_infer: serving %lu streams with %lu threads (IMU only, hop %lu)...\n",
+                  (unsigned long)streams, (unsigned long)threads, (unsigned long)hop);
+
+        MultiStreamServer server(streams, window_size, hop, EI_CLASSIFIER_LABEL_COUNT,
+                                 threads, &classify_windows, STDOUT_FILENO);
+
+        size_t bad_ids = 0;
+        read_records<ei_infer_stream_sample_t>(
+            [&](const ei_infer_stream_sample_t &sample) {
+                if (!server.push(sample.stream_id, sample.imu, input_arrival_us)) {
+                    bad_ids++;
+                    metrics.dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            },
+            [] { return true; });
+
+        server.finish();
+
+        if (bad_ids > 0) {
+            ei_printf("WARN: dropped %lu samples with a stream id >= %lu\n",
+                      (unsigned long)bad_ids, (unsigned long)streams);
+        }
+        return 0;
+    }
+
+    // Ring buffer instead of a shifted array: pushing a sample is O(1) and
+    // the DSP blocks read straight out of it through the signal_t
+    static RingWindow window(window_size);
+
+    // Wrap the buffer in a signal_t once
+    signal_t signal;
+    window.to_signal(&signal);
 
     ei_impulse_result_t result;
     size_t samples_seen = 0;
 
-    ei_printf("ei_stdin_infer: reading mic,imu lines from stdin (IMU only)...\n");
+    // --gate: scores of the last quiet window that was classified as no hit on
+    // --label, handed out again for quiet windows instead of running the impulse
+    ActivityGate gate(window_size, hop, gate_floor, gate_variance);
+    std::vector<float> noise_scores;
+    bool has_noise = false;
+
+    // --continuous: the SDK keeps the window, we only hand it each new slice
+    std::vector<float> slice;
+    if (continuous) {
+        slice.reserve(EI_CLASSIFIER_SLICE_SIZE);
+        run_classifier_init();
+    }
+
+    // Push one IMU sample, returns true if a new result is in `result`
+    auto on_sample = [&](float imu) {
+        samples_seen++;
+        metrics.samples.fetch_add(1, std::memory_order_relaxed);
+
+        if (continuous) {
+            slice.push_back(imu);
+            if (slice.size() < EI_CLASSIFIER_SLICE_SIZE) {
+                return false;
+            }
+            signal_t slice_signal;
+            numpy::signal_from_buffer(slice.data(), slice.size(), &slice_signal);
+            EI_IMPULSE_ERROR ei_err = run_classifier_continuous(&slice_signal, &result, false);
+            slice.clear();
+            if (ei_err != EI_IMPULSE_OK) {
+                metrics.classify_errors.fetch_add(1, std::memory_order_relaxed);
+                ei_printf("ERR: run_classifier_continuous (%d)\n", ei_err);
+                return false;
+            }
+            // the first slices only fill the SDK's window
+            if (samples_seen < window_size) {
+                return false;
+            }
+            metrics.record_window((uint32_t)result.timing.dsp_us,
+                                  (uint32_t)result.timing.classification_us, input_arrival_us);
+            return true;
+        }
+
+        window.push(imu);
+        if (gating) {
+            gate.push(imu);
+        }
+
+        // Wait until we've filled one full window
+        if (samples_seen < window_size) {
+            return false;
+        }
+
+        // Then only classify every `hop` samples
+        if ((samples_seen - window_size) % hop != 0) {
+            return false;
+        }
+
+        const bool quiet = gating && gate.quiet();
+        if (quiet && has_noise) {
+            // result.classification still points at the labels of the last run
+            for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+                result.classification[ix].value = noise_scores[ix];
+            }
+            result.timing.dsp_us = 0;
+            result.timing.classification_us = 0;
+            metrics.gated_windows.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        EI_IMPULSE_ERROR ei_err = run_classifier(&signal, &result, false);
+        if (ei_err != EI_IMPULSE_OK) {
+            metrics.classify_errors.fetch_add(1, std::memory_order_relaxed);
+            ei_printf("ERR: run_classifier (%d)\n", ei_err);
+            return false;
+        }
+        // refreshed on the first quiet window after every active stretch; a
+        // quiet window that still scores a hit isn't noise, keep classifying
+        has_noise = quiet && result.classification[event_ix].value < threshold;
+        if (has_noise) {
+            noise_scores.resize(EI_CLASSIFIER_LABEL_COUNT);
+            for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+                noise_scores[ix] = result.classification[ix].value;
+            }
+        }
+        metrics.record_window((uint32_t)result.timing.dsp_us,
+                              (uint32_t)result.timing.classification_us, input_arrival_us);
+        return true;
+    };
+
+    EventDetector detector(threshold, release, min_consecutive, refractory);
+    EventDetector::Event event;
+
+    if (events) {
+        ei_printf("ei_stdin_infer: reporting '%s' events (threshold %.2f, release %.2f, "
+                  "%lu in a row, refractory %lu samples)\n",
+                  event_label, threshold, release, (unsigned long)min_consecutive,
+                  (unsigned long)refractory);
+    }
+
+    if (gating) {
+        if (gate_variance > 0.0f) {
+            ei_printf("ei_stdin_infer: skipping quiet windows (IMU peak-to-peak < %g, variance < %g)\n",
+                      gate_floor, gate_variance);
+        }
+        else {
+            ei_printf("ei_stdin_infer: skipping quiet windows (IMU peak-to-peak < %g)\n", gate_floor);
+        }
+    }
+
+    // how many windows the gate answered, on the log at the end
+    auto report_gate = [&]() {
+        if (gating) {
+            const uint64_t gated = metrics.gated_windows.load(std::memory_order_relaxed);
+            ei_printf("ei_stdin_infer: gate skipped %llu of %llu windows\n",
+                      (unsigned long long)gated,
+                      (unsigned long long)(gated + metrics.windows.load(std::memory_order_relaxed)));
+        }
+    };
+
+    if (binary) {
+        ei_printf("ei_stdin_infer: reading binary samples from %s (IMU only, hop %lu)...\n",
+                  shm_name ? shm_name : "stdin", (unsigned long)hop);
+
+        const size_t label_count = EI_CLASSIFIER_LABEL_COUNT;
+        const size_t result_size = sizeof(ei_infer_result_t) + label_count * sizeof(float);
+        std::vector<uint8_t> out;
+
+        // append one ei_infer_event_t for `event`
+        auto push_event = [&]() {
+            ei_infer_event_t rec;
+            rec.type = event.type == EventDetector::START ? EI_INFER_EVENT_START : EI_INFER_EVENT_END;
+            rec.label = (uint8_t)event_ix;
+            rec.reserved = 0;
+            rec.sample_index = event.sample_index;
+            rec.start_index = event.start_index;
+            rec.score = event.score;
+            out.insert(out.end(), (uint8_t *)&rec, (uint8_t *)&rec + sizeof(rec));
+        };
+
+        read_records<ei_infer_sample_t>(
+            [&](const ei_infer_sample_t &sample) {
+                if (!on_sample(sample.imu)) {
+                    return;
+                }
+
+                if (events) {
+                    if (detector.update(result.classification[event_ix].value, samples_seen, &event)) {
+                        push_event();
+                    }
+                    return;
+                }
+
+                size_t at = out.size();
+                out.resize(at + result_size);
+
+                ei_infer_result_t rec;
+                rec.sample_index = samples_seen;
+                rec.dsp_us = (uint32_t)result.timing.dsp_us;
+                rec.classification_us = (uint32_t)result.timing.classification_us;
+                memcpy(&out[at], &rec, sizeof(rec));
+                for (size_t lx = 0; lx < label_count; lx++) {
+                    float v = result.classification[lx].value;
+                    memcpy(&out[at + sizeof(rec) + lx * sizeof(float)], &v, sizeof(float));
+                }
+            },
+            [&] {
+                // one write for everything this chunk produced
+                bool ok = out.empty() || write_all(STDOUT_FILENO, out.data(), out.size());
+                out.clear();
+                return ok;
+            });
+
+        if (events && detector.flush(samples_seen, &event)) {
+            push_event();
+            write_all(STDOUT_FILENO, out.data(), out.size());
+        }
+        report_gate();
+        return 0;
+    }
+
+    ei_printf("ei_stdin_infer: reading mic,imu lines from stdin (IMU only, hop %lu)...\n",
+              (unsigned long)hop);
 
     std::string line;
     while (std::getline(std::cin, line)) {
         if (line.empty()) continue;
+        input_arrival_us = ei_read_timer_us();
 
         float mic = 0.0f, imu = 0.0f;
         {
             std::stringstream ss(line);
             std::string a, b;
             if (!std::getline(ss, a, ',') || !std::getline(ss, b, ',')) {
+                metrics.parse_errors.fetch_add(1, std::memory_order_relaxed);
                 continue;  // malformed
             }
             try {
                 mic = std::stof(a);  // parsed but unused
                 imu = std::stof(b);  // IMU is what we care about
             } catch (...) {
+                metrics.parse_errors.fetch_add(1, std::memory_order_relaxed);
                 continue;
             }
         }
+        (void)mic;
 
         // Only IMU goes into the model
-        push_sample(imu);
-        samples_seen++;
-
-        // Wait until we've filled one full window
-        if (samples_seen < window_size) {
+        if (!on_sample(imu)) {
             continue;
         }
 
-        EI_IMPULSE_ERROR ei_err = run_classifier(&signal, &result, false);
-        if (ei_err != EI_IMPULSE_OK) {
-            ei_printf("ERR: run_classifier (%d)\n", ei_err);
+        if (events) {
+            if (detector.update(result.classification[event_ix].value, samples_seen, &event)) {
+                print_event(stdout, event_label, event, "");
+            }
             continue;
         }
 
@@ -79,5 +792,10 @@ int main() {
         std::fflush(stdout);
     }
 
+    if (events && detector.flush(samples_seen, &event)) {
+        print_event(stdout, event_label, event, "");
+    }
+
+    report_gate();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,324 @@
+#include "metrics.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+Metrics metrics;
+
+LatencyHistogram::LatencyHistogram()
+    : count_(0)
+    , sum_(0)
+    , max_(0)
+{
+    for (int ix = 0; ix < BUCKETS; ix++) {
+        buckets_[ix].store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucket_of(uint64_t us) {
+    if (us >= ((uint64_t)1 << 32)) {
+        return BUCKETS - 1;
+    }
+    if (us < (uint64_t)SUB_COUNT) {
+        return (int)us;
+    }
+    // us is in [2^exp, 2^(exp+1)), keep its top SUB_BITS + 1 bits
+    int exp = SUB_BITS;
+    while ((us >> (exp + 1)) != 0) {
+        exp++;
+    }
+    const int shift = exp - SUB_BITS;
+    const int sub = (int)((us >> shift) & (SUB_COUNT - 1));
+    return (shift + 1) * SUB_COUNT + sub;
+}
+
+uint64_t LatencyHistogram::highest_in(int bucket) {
+    if (bucket < SUB_COUNT) {
+        return (uint64_t)bucket;
+    }
+    const int shift = bucket / SUB_COUNT - 1;
+    const uint64_t sub = (uint64_t)(bucket % SUB_COUNT);
+    return ((SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t us) {
+    buckets_[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t prev = max_.load(std::memory_order_relaxed);
+    while (us > prev && !max_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    const uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int ix = 0; ix < BUCKETS; ix++) {
+        seen += buckets_[ix].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t v = highest_in(ix);
+            return v < max() ? v : max();
+        }
+    }
+    return max();
+}
+
+Metrics::Metrics()
+    : samples(0)
+    , windows(0)
+    , gated_windows(0)
+    , parse_errors(0)
+    , dropped(0)
+    , classify_errors(0)
+    , input_backlog_bytes(0)
+    , pending_windows(0)
+{
+}
+
+void Metrics::record_window(uint32_t dsp, uint32_t classification, uint64_t arrival_us) {
+    windows.fetch_add(1, std::memory_order_relaxed);
+    dsp_us.record(dsp);
+    classification_us.record(classification);
+    end_to_end_us.record(ei_read_timer_us() - arrival_us);
+}
+
+static void append(std::string *out, const char *format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n > 0) {
+        out->append(buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+    }
+}
+
+static void append_short(std::string *out, const char *name, const LatencyHistogram &h) {
+    append(out, " %s p50=%llu p99=%llu max=%llu", name,
+           (unsigned long long)h.percentile(50), (unsigned long long)h.percentile(99),
+           (unsigned long long)h.max());
+}
+
+std::string Metrics::stats_line(double interval_s, uint64_t *last_samples,
+                                uint64_t *last_windows) const {
+    const uint64_t s = samples.load(std::memory_order_relaxed);
+    const uint64_t w = windows.load(std::memory_order_relaxed);
+    const double rate_s = interval_s > 0 ? (s - *last_samples) / interval_s : 0;
+    const double rate_w = interval_s > 0 ? (w - *last_windows) / interval_s : 0;
+    *last_samples = s;
+    *last_windows = w;
+
+    std::string out;
+    append(&out, "stats: samples=%llu (%.0f/s) windows=%llu (%.0f/s) gated=%llu parse_errors=%llu "
+           "dropped=%llu classify_errors=%llu backlog=%lluB pending=%llu",
+           (unsigned long long)s, rate_s, (unsigned long long)w, rate_w,
+           (unsigned long long)gated_windows.load(std::memory_order_relaxed),
+           (unsigned long long)parse_errors.load(std::memory_order_relaxed),
+           (unsigned long long)dropped.load(std::memory_order_relaxed),
+           (unsigned long long)classify_errors.load(std::memory_order_relaxed),
+           (unsigned long long)input_backlog_bytes.load(std::memory_order_relaxed),
+           (unsigned long long)pending_windows.load(std::memory_order_relaxed));
+    append_short(&out, "dsp_us", dsp_us);
+    append_short(&out, "classification_us", classification_us);
+    append_short(&out, "e2e_us", end_to_end_us);
+    out += "\n";
+    return out;
+}
+
+static void expose_value(std::string *out, const char *name, const char *type, const char *help,
+                         uint64_t value) {
+    append(out, "# HELP ei_infer_%s %s\n# TYPE ei_infer_%s %s\nei_infer_%s %llu\n",
+           name, help, name, type, name, (unsigned long long)value);
+}
+
+static void expose_summary(std::string *out, const char *name, const char *help,
+                           const LatencyHistogram &h) {
+    static const double quantiles[] = { 0.5, 0.9, 0.95, 0.99, 0.999, 1.0 };
+
+    append(out, "# HELP ei_infer_%s %s\n# TYPE ei_infer_%s summary\n", name, help, name);
+    for (size_t ix = 0; ix < sizeof(quantiles) / sizeof(quantiles[0]); ix++) {
+        append(out, "ei_infer_%s{quantile=\"%g\"} %llu\n", name, quantiles[ix],
+               (unsigned long long)h.percentile(quantiles[ix] * 100.0));
+    }
+    append(out, "ei_infer_%s_sum %llu\nei_infer_%s_count %llu\n",
+           name, (unsigned long long)h.sum(), name, (unsigned long long)h.count());
+}
+
+std::string Metrics::exposition() const {
+    std::string out;
+    expose_value(&out, "samples_total", "counter", "Samples ingested",
+                 samples.load(std::memory_order_relaxed));
+    expose_value(&out, "windows_total", "counter", "Windows classified",
+                 windows.load(std::memory_order_relaxed));
+    expose_value(&out, "gated_windows_total", "counter",
+                 "Quiet windows skipped by the activity gate (answered with the cached noise result)",
+                 gated_windows.load(std::memory_order_relaxed));
+    expose_value(&out, "parse_errors_total", "counter", "Input lines or records that did not parse",
+                 parse_errors.load(std::memory_order_relaxed));
+    expose_value(&out, "dropped_samples_total", "counter", "Samples for unknown stream ids",
+                 dropped.load(std::memory_order_relaxed));
+    expose_value(&out, "classify_errors_total", "counter", "Failed run_classifier calls",
+                 classify_errors.load(std::memory_order_relaxed));
+    expose_value(&out, "input_backlog_bytes", "gauge", "Unread bytes waiting on the input",
+                 input_backlog_bytes.load(std::memory_order_relaxed));
+    expose_value(&out, "pending_windows", "gauge", "Windows queued for classification",
+                 pending_windows.load(std::memory_order_relaxed));
+    expose_summary(&out, "dsp_us", "DSP time per window in microseconds", dsp_us);
+    expose_summary(&out, "classification_us", "NN time per window in microseconds",
+                   classification_us);
+    expose_summary(&out, "end_to_end_us",
+                   "Time from the closing sample arriving to its result in microseconds",
+                   end_to_end_us);
+    return out;
+}
+
+MetricsReporter::MetricsReporter()
+    : interval_s_(0)
+    , listen_fd_(-1)
+    , stopping_(false)
+{
+}
+
+MetricsReporter::~MetricsReporter() {
+    stop();
+}
+
+bool MetricsReporter::start(size_t interval_s, const char *socket_path) {
+    interval_s_ = interval_s;
+
+    if (socket_path) {
+#ifndef _WIN32
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+            ei_printf("ERR: metrics socket path too long: %s\n", socket_path);
+            return false;
+        }
+        strcpy(addr.sun_path, socket_path);
+
+        unlink(socket_path);
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd_ < 0 || bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            listen(listen_fd_, 8) != 0) {
+            ei_printf("ERR: cannot listen on metrics socket %s\n", socket_path);
+            if (listen_fd_ >= 0) {
+                close(listen_fd_);
+                listen_fd_ = -1;
+            }
+            return false;
+        }
+        socket_path_ = socket_path;
+#else
+        ei_printf("ERR: --metrics-socket is not supported on Windows\n");
+        return false;
+#endif
+    }
+
+    if (interval_s_ > 0 || listen_fd_ >= 0) {
+        thread_ = std::thread(&MetricsReporter::run, this);
+    }
+    return true;
+}
+
+void MetricsReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+#ifndef _WIN32
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(socket_path_.c_str());
+        listen_fd_ = -1;
+    }
+#endif
+}
+
+void MetricsReporter::run() {
+    // how often we look at the socket / the stop flag
+    const uint64_t tick_ms = 100;
+
+    uint64_t last_samples = 0, last_windows = 0;
+    uint64_t last_us = ei_read_timer_us();
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (listen_fd_ < 0) {
+                cond_.wait_for(lock, std::chrono::milliseconds(tick_ms), [this] { return stopping_; });
+            }
+            if (stopping_) {
+                break;
+            }
+        }
+
+#ifndef _WIN32
+        if (listen_fd_ >= 0) {
+            struct pollfd pfd = { listen_fd_, POLLIN, 0 };
+            if (poll(&pfd, 1, (int)tick_ms) > 0) {
+                int fd = accept(listen_fd_, nullptr, nullptr);
+                if (fd >= 0) {
+#ifdef SO_NOSIGPIPE
+                    int one = 1;
+                    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+                    const std::string text = metrics.exposition();
+                    size_t off = 0;
+                    while (off < text.size()) {
+                        // a scraper hanging up mid-response must not SIGPIPE ei_infer
+                        ssize_t n = send(fd, text.data() + off, text.size() - off, MSG_NOSIGNAL);
+                        if (n <= 0) {
+                            break;
+                        }
+                        off += (size_t)n;
+                    }
+                    close(fd);
+                }
+            }
+        }
+#endif
+
+        const uint64_t now_us = ei_read_timer_us();
+        if (interval_s_ > 0 && now_us - last_us >= interval_s_ * 1000000) {
+            const std::string line = metrics.stats_line((now_us - last_us) / 1e6,
+                                                        &last_samples, &last_windows);
+            std::fputs(line.c_str(), stderr);
+            last_us = now_us;
+        }
+    }
+
+    // one last line with the totals on the way out
+    if (interval_s_ > 0) {
+        const uint64_t now_us = ei_read_timer_us();
+        const std::string line = metrics.stats_line((now_us - last_us) / 1e6,
+                                                    &last_samples, &last_windows);
+        std::fputs(line.c_str(), stderr);
+    }
+}
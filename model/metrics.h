@@ -0,0 +1,98 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Log-linear latency histogram in the spirit of HdrHistogram: exact below
+// 32 us, then 32 buckets per power of two (values within ~3%), up to 2^32 us.
+// record() is lock-free and safe from any thread.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t us);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    // Highest value in the bucket holding the p-th percentile (0..100)
+    uint64_t percentile(double p) const;
+
+private:
+    static const int SUB_BITS = 5;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int BUCKETS = (32 - SUB_BITS + 1) * SUB_COUNT;
+
+    static int bucket_of(uint64_t us);
+    static uint64_t highest_in(int bucket);
+
+    std::atomic<uint64_t> buckets_[BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+// Everything ei_infer counts, shared by all ingest paths and worker threads
+struct Metrics {
+    Metrics();
+
+    std::atomic<uint64_t> samples;              // samples ingested
+    std::atomic<uint64_t> windows;              // windows classified
+    std::atomic<uint64_t> gated_windows;        // quiet windows answered by the activity gate
+    std::atomic<uint64_t> parse_errors;         // lines / records that didn't parse
+    std::atomic<uint64_t> dropped;              // samples for unknown streams
+    std::atomic<uint64_t> classify_errors;      // run_classifier failures
+    std::atomic<uint64_t> input_backlog_bytes;  // unread bytes on the input (pipe or ring)
+    std::atomic<uint64_t> pending_windows;      // windows queued for the workers
+
+    LatencyHistogram dsp_us;
+    LatencyHistogram classification_us;
+    LatencyHistogram end_to_end_us;             // sample arrival to result out
+
+    // Record one classified window
+    void record_window(uint32_t dsp, uint32_t classification, uint64_t arrival_us);
+
+    // One-line summary for the periodic stats output. Rates are relative to
+    // *last_samples / *last_windows, `interval_s` seconds ago; both are updated.
+    std::string stats_line(double interval_s, uint64_t *last_samples, uint64_t *last_windows) const;
+
+    // Prometheus text exposition format
+    std::string exposition() const;
+};
+
+extern Metrics metrics;
+
+// Prints metrics.stats_line() to stderr every `interval_s` seconds and/or
+// serves metrics.exposition() to anyone connecting to the unix socket at
+// `socket_path`, from a background thread.
+class MetricsReporter {
+public:
+    MetricsReporter();
+    ~MetricsReporter();
+
+    // interval_s == 0 disables the stats line, socket_path == nullptr the socket
+    bool start(size_t interval_s, const char *socket_path);
+    void stop();
+
+private:
+    void run();
+
+    size_t interval_s_;
+    std::string socket_path_;
+    int listen_fd_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stopping_;
+    std::thread thread_;
+};
+
+#endif // METRICS_H
@@ -120,7 +120,7 @@ ei_model_dsp_t ei_dsp_blocks_796726_1[ei_dsp_blocks_796726_1_size] = {
         ei_dsp_config_796726_2_axes, // array of offsets into the input stream, one for each axis
         ei_dsp_config_796726_2_axes_size, // number of axes
         1, // version
-        nullptr, // factory function
+        &spectrogram_cache_class::create, // factory function (frame cache across windows)
         nullptr, // data normalization config
     },
     { // DSP block 6
@@ -131,7 +131,7 @@ ei_model_dsp_t ei_dsp_blocks_796726_1[ei_dsp_blocks_796726_1_size] = {
         ei_dsp_config_796726_6_axes, // array of offsets into the input stream, one for each axis
         ei_dsp_config_796726_6_axes_size, // number of axes
         1, // version
-        nullptr, // factory function
+        &spectral_analysis_class::create, // factory function (keeps the wavelet workspace)
         &ei_data_normalization_config_796726_6, // data normalization config
     }
 };
@@ -142,6 +142,14 @@ const ei_config_tflite_eon_graph_t ei_config_graph_796726_5 = {
     .model_reset = &tflite_learn_796726_5_reset,
     .model_input = &tflite_learn_796726_5_input,
     .model_output = &tflite_learn_796726_5_output,
+    .model_batch_arena_size = &tflite_learn_796726_5_batch_arena_size,
+    .model_invoke_batch = &tflite_learn_796726_5_invoke_batch,
+    .model_init_instance = &tflite_learn_796726_5_init_instance,
+    .model_input_instance = &tflite_learn_796726_5_input_instance,
+    .model_output_instance = &tflite_learn_796726_5_output_instance,
+    .model_invoke_instance = &tflite_learn_796726_5_invoke_instance,
+    .model_invoke_batch_instance = &tflite_learn_796726_5_invoke_batch_instance,
+    .model_reset_instance = &tflite_learn_796726_5_reset_instance,
 };
 
 const uint8_t ei_output_tensors_indices_796726_5[1] = { 0 };
@@ -0,0 +1,185 @@
+#include "multi_stream.h"
+
+#include <cstring>
+
+#include "ei_infer_protocol.h"
+#include "io_util.h"
+#include "metrics.h"
+
+// Flush the shared output buffer once it gets this big, even if more
+// results are about to be appended
+static const size_t OUT_FLUSH_BYTES = 64 * 1024;
+
+// Most queued windows one worker classifies in one call
+static const size_t MAX_BATCH = 16;
+
+MultiStreamServer::MultiStreamServer(size_t max_streams, size_t window_size, size_t hop,
+                                     size_t label_count, size_t threads,
+                                     classify_batch_fn_t classify, int out_fd)
+    : window_size_(window_size)
+    , hop_(hop)
+    , label_count_(label_count)
+    , max_pending_(threads * 64)
+    , classify_(classify)
+    , out_fd_(out_fd)
+    , streams_(max_streams)
+    , stopping_(false)
+{
+    for (size_t ix = 0; ix < threads; ix++) {
+        workers_.push_back(std::thread(&MultiStreamServer::worker, this));
+    }
+}
+
+MultiStreamServer::~MultiStreamServer() {
+    finish();
+}
+
+bool MultiStreamServer::push(uint32_t stream_id, float imu, uint64_t arrival_us) {
+    if (stream_id >= streams_.size()) {
+        return false;
+    }
+
+    // streams are created on their first sample
+    std::unique_ptr<Stream> &stream = streams_[stream_id];
+    if (!stream) {
+        stream.reset(new Stream(window_size_));
+    }
+
+    stream->window.push(imu);
+    stream->samples_seen++;
+    metrics.samples.fetch_add(1, std::memory_order_relaxed);
+
+    if (stream->samples_seen < window_size_ ||
+        (stream->samples_seen - window_size_) % hop_ != 0) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+
+    // backpressure: don't let the ingest loop run away from the workers
+    queue_not_full_.wait(lock, [this] { return queue_.size() < max_pending_; });
+
+    std::unique_ptr<Job> job;
+    if (!free_jobs_.empty()) {
+        job = std::move(free_jobs_.back());
+        free_jobs_.pop_back();
+    }
+    else {
+        job.reset(new Job());
+        job->window.resize(window_size_);
+    }
+
+    // snapshot the window, the stream keeps sliding while the job is queued
+    job->stream_id = stream_id;
+    job->sample_index = stream->samples_seen;
+    job->arrival_us = arrival_us;
+    stream->window.read(0, window_size_, job->window.data());
+
+    queue_.push_back(std::move(job));
+    metrics.pending_windows.store(queue_.size(), std::memory_order_relaxed);
+    lock.unlock();
+    queue_not_empty_.notify_one();
+
+    return true;
+}
+
+void MultiStreamServer::finish() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    queue_not_empty_.notify_all();
+
+    for (size_t ix = 0; ix < workers_.size(); ix++) {
+        workers_[ix].join();
+    }
+
+    std::lock_guard<std::mutex> lock(out_mutex_);
+    flush_locked();
+}
+
+size_t MultiStreamServer::active_streams() const {
+    size_t n = 0;
+    for (size_t ix = 0; ix < streams_.size(); ix++) {
+        if (streams_[ix]) {
+            n++;
+        }
+    }
+    return n;
+}
+
+void MultiStreamServer::worker() {
+    const size_t record_size = sizeof(ei_infer_stream_result_t) + label_count_ * sizeof(float);
+    std::vector<std::unique_ptr<Job> > jobs;
+    std::vector<float> windows(MAX_BATCH * window_size_);
+    std::vector<uint32_t> dsp_us(MAX_BATCH), classification_us(MAX_BATCH);
+    std::vector<float> scores(MAX_BATCH * label_count_);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_not_empty_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+            if (queue_.empty()) {
+                return; // stopping and drained
+            }
+            // take whatever is waiting (up to MAX_BATCH), never wait for more
+            while (!queue_.empty() && jobs.size() < MAX_BATCH) {
+                jobs.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            metrics.pending_windows.store(queue_.size(), std::memory_order_relaxed);
+        }
+        queue_not_full_.notify_all();
+
+        for (size_t ix = 0; ix < jobs.size(); ix++) {
+            memcpy(&windows[ix * window_size_], jobs[ix]->window.data(), window_size_ * sizeof(float));
+        }
+        bool ok = classify_(windows.data(), jobs.size(), window_size_,
+                            dsp_us.data(), classification_us.data(), scores.data());
+
+        {
+            std::lock_guard<std::mutex> lock(out_mutex_);
+            for (size_t ix = 0; ix < jobs.size() && ok; ix++) {
+                ei_infer_stream_result_t rec;
+                rec.stream_id = jobs[ix]->stream_id;
+                rec.sample_index = jobs[ix]->sample_index;
+                rec.dsp_us = dsp_us[ix];
+                rec.classification_us = classification_us[ix];
+                metrics.record_window(rec.dsp_us, rec.classification_us, jobs[ix]->arrival_us);
+
+                size_t at = out_.size();
+                out_.resize(at + record_size);
+                memcpy(&out_[at], &rec, sizeof(rec));
+                memcpy(&out_[at + sizeof(rec)], &scores[ix * label_count_], label_count_ * sizeof(float));
+            }
+        }
+
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            for (size_t ix = 0; ix < jobs.size(); ix++) {
+                free_jobs_.push_back(std::move(jobs[ix]));
+            }
+            idle = queue_.empty();
+        }
+        jobs.clear();
+
+        std::lock_guard<std::mutex> lock(out_mutex_);
+        // batch results into as few writes as possible, but don't sit on
+        // them once there's nothing left to classify
+        if (idle || out_.size() >= OUT_FLUSH_BYTES) {
+            flush_locked();
+        }
+    }
+}
+
+void MultiStreamServer::flush_locked() {
+    if (out_.empty()) {
+        return;
+    }
+    write_all(out_fd_, out_.data(), out_.size());
+    out_.clear();
+}
@@ -0,0 +1,82 @@
+#ifndef MULTI_STREAM_H
+#define MULTI_STREAM_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "classify_fn.h"
+#include "ring_window.h"
+
+// Serves many devices from one process. Each stream id gets its own sliding
+// window; whenever a stream's window is due for classification a snapshot of
+// it is queued, and a fixed pool of worker threads classifies the snapshots
+// (a worker takes every queued snapshot, up to a limit, in one batch) and
+// writes ei_infer_stream_result_t records to `out_fd`.
+//
+// push() must only be called from one thread (the ingest loop). Results for
+// one stream can come out of order when there is more than one worker, use
+// the sample_index in the record to order them.
+class MultiStreamServer {
+public:
+    MultiStreamServer(size_t max_streams, size_t window_size, size_t hop,
+                      size_t label_count, size_t threads,
+                      classify_batch_fn_t classify, int out_fd);
+    ~MultiStreamServer();
+
+    // Add one sample to a stream, returns false if stream_id is out of range.
+    // arrival_us is when the sample was received, for the end-to-end latency.
+    bool push(uint32_t stream_id, float imu, uint64_t arrival_us);
+
+    // Wait for all queued windows to be classified and written, then stop
+    // the workers. Called by the destructor if not called before.
+    void finish();
+
+    size_t active_streams() const;
+
+private:
+    struct Stream {
+        explicit Stream(size_t window_size) : window(window_size), samples_seen(0) { }
+        RingWindow window;
+        uint64_t samples_seen;
+    };
+
+    struct Job {
+        uint32_t stream_id;
+        uint64_t sample_index;
+        uint64_t arrival_us;
+        std::vector<float> window;
+    };
+
+    void worker();
+    void flush_locked();
+
+    const size_t window_size_;
+    const size_t hop_;
+    const size_t label_count_;
+    const size_t max_pending_;
+    classify_batch_fn_t classify_;
+    const int out_fd_;
+
+    // only touched by the ingest thread
+    std::vector<std::unique_ptr<Stream> > streams_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_not_empty_;
+    std::condition_variable queue_not_full_;
+    std::deque<std::unique_ptr<Job> > queue_;
+    std::vector<std::unique_ptr<Job> > free_jobs_;
+    bool stopping_;
+
+    std::mutex out_mutex_;
+    std::vector<uint8_t> out_;
+
+    std::vector<std::thread> workers_;
+};
+
+#endif // MULTI_STREAM_H
@@ -0,0 +1,66 @@
+#ifndef RING_WINDOW_H
+#define RING_WINDOW_H
+
+#include <cstring>
+#include <vector>
+
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+#include "edge-impulse-sdk/dsp/returntypes.hpp"
+
+// Sliding window over the most recent `size` samples, kept in a circular
+// buffer so pushing a sample is O(1). Offset 0 of the window is always the
+// oldest sample; until the buffer has wrapped once the oldest samples are 0,
+// same as a zero-initialised shift buffer.
+class RingWindow {
+public:
+    explicit RingWindow(size_t size)
+        : buf_(size, 0.0f), head_(0) { }
+
+    void push(float v) {
+        // head_ is the oldest sample, so overwrite it and move on
+        buf_[head_] = v;
+        if (++head_ == buf_.size()) {
+            head_ = 0;
+        }
+    }
+
+    size_t size() const { return buf_.size(); }
+
+    // Copy `length` samples starting at window offset `offset` into out_ptr.
+    // At most two memcpy's: the tail of the ring, then the wrapped head.
+    int read(size_t offset, size_t length, float *out_ptr) const {
+        const size_t n = buf_.size();
+        if (offset + length > n) {
+            return ei::EIDSP_OUT_OF_BOUNDS;
+        }
+
+        size_t start = head_ + offset;
+        if (start >= n) {
+            start -= n;
+        }
+
+        size_t first = n - start;
+        if (first > length) {
+            first = length;
+        }
+
+        memcpy(out_ptr, buf_.data() + start, first * sizeof(float));
+        memcpy(out_ptr + first, buf_.data(), (length - first) * sizeof(float));
+        return ei::EIDSP_OK;
+    }
+
+    // Point a signal_t at this window. The signal holds a pointer to this
+    // object, so the window must outlive it (and must not be moved).
+    void to_signal(ei::signal_t *signal) const {
+        signal->total_length = buf_.size();
+        signal->get_data = [this](size_t offset, size_t length, float *out_ptr) {
+            return this->read(offset, length, out_ptr);
+        };
+    }
+
+private:
+    std::vector<float> buf_;
+    size_t head_;
+};
+
+#endif // RING_WINDOW_H
@@ -0,0 +1,36 @@
+#ifndef SAMPLE_PARSE_H
+#define SAMPLE_PARSE_H
+
+#include <cstdlib>
+#include <cstring>
+
+// Parse the imu column of one "mic,imu" line in [p, end), which doesn't have
+// to be NUL terminated. Header and comment lines ("mic,imu", "# Total data
+// points logged: ...") don't parse and are skipped, same as in the live
+// text path.
+static inline bool parse_imu_line(const char *p, const char *end, float *imu) {
+    const char *comma = (const char *)memchr(p, ',', end - p);
+    if (comma == nullptr) {
+        return false;
+    }
+    const char *field = comma + 1;
+    const char *field_end = (const char *)memchr(field, ',', end - field);
+    if (field_end == nullptr) {
+        field_end = end;
+    }
+
+    // copy out so strtof can't run past the end
+    char buf[64];
+    size_t len = field_end - field;
+    if (len == 0 || len >= sizeof(buf)) {
+        return false;
+    }
+    memcpy(buf, field, len);
+    buf[len] = '\0';
+
+    char *parsed_end = nullptr;
+    *imu = std::strtof(buf, &parsed_end);
+    return parsed_end != buf;
+}
+
+#endif // SAMPLE_PARSE_H
@@ -0,0 +1,148 @@
+// Producer for `ei_infer --shm NAME`. Reads mic,imu lines (a recorded CSV or
+// a live relay) from stdin and publishes them into the shared-memory ring as
+// the same records ei_infer takes on stdin with --binary, then closes the
+// ring so ei_infer drains it and exits.
+//
+//   ei_infer --shm /ei_knock > preds.bin &
+//   shm_feed /ei_knock < ../collected-data/example_datastream.csv
+//
+// With --streams N every sample goes to each of the streams 0..N-1, to
+// drive `ei_infer --shm NAME --streams N`.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "ei_infer_protocol.h"
+#include "sample_parse.h"
+#include "shm_ring.h"
+
+namespace {
+
+// Records handed to ShmRing::write at a time
+const size_t FEED_BATCH = 1024;
+
+void print_usage(const char *prog) {
+    std::fprintf(stderr,
+                 "usage: %s NAME [--streams N] [--wait SECONDS]\n"
+                 "  NAME          ring created by `ei_infer --shm NAME`, e.g. /ei_knock\n"
+                 "  --streams N   send every sample to streams 0..N-1 (ei_infer --streams N)\n"
+                 "  --wait S      how long to wait for ei_infer to create the ring (default 5)\n",
+                 prog);
+}
+
+bool parse_count(const char *flag, const char *arg, size_t *out) {
+    char *end = nullptr;
+    unsigned long n = std::strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || n == 0) {
+        std::fprintf(stderr, "invalid %s value '%s'\n", flag, arg);
+        return false;
+    }
+    *out = n;
+    return true;
+}
+
+// Pending records, written out once FEED_BATCH of them are in
+template<typename Record>
+class Feeder {
+public:
+    explicit Feeder(ShmRing *ring) : ring_(ring) { records_.reserve(FEED_BATCH); }
+
+    bool push(const Record &rec) {
+        records_.push_back(rec);
+        return records_.size() < FEED_BATCH || flush();
+    }
+
+    bool flush() {
+        bool ok = records_.empty() || ring_->write(records_.data(), records_.size());
+        records_.clear();
+        return ok;
+    }
+
+private:
+    ShmRing *ring_;
+    std::vector<Record> records_;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *name = nullptr;
+    size_t streams = 0;
+    size_t wait_s = 5;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--streams") == 0 && i + 1 < argc) {
+            if (!parse_count("--streams", argv[++i], &streams)) {
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--wait") == 0 && i + 1 < argc) {
+            if (!parse_count("--wait", argv[++i], &wait_s)) {
+                return 1;
+            }
+        }
+        else if (argv[i][0] != '-' && name == nullptr) {
+            name = argv[i];
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (name == nullptr) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // ei_infer may still be starting up, poll for the ring
+    const uint32_t record_size = streams > 0 ? sizeof(ei_infer_stream_sample_t)
+                                             : sizeof(ei_infer_sample_t);
+    ShmRing ring;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(wait_s);
+    while (!ring.attach(name, record_size)) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            std::fprintf(stderr, "cannot attach to shared-memory ring %s\n", name);
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    Feeder<ei_infer_sample_t> single(&ring);
+    Feeder<ei_infer_stream_sample_t> multi(&ring);
+    size_t samples = 0;
+    bool ok = true;
+
+    char line[256];
+    while (ok && std::fgets(line, sizeof(line), stdin)) {
+        const char *end = line + strlen(line);
+        float imu;
+        if (!parse_imu_line(line, end, &imu)) {
+            continue;
+        }
+        const float mic = std::strtof(line, nullptr);
+        samples++;
+
+        if (streams == 0) {
+            ei_infer_sample_t rec = { mic, imu };
+            ok = single.push(rec);
+            continue;
+        }
+        for (size_t sx = 0; sx < streams && ok; sx++) {
+            ei_infer_stream_sample_t rec = { (uint32_t)sx, mic, imu };
+            ok = multi.push(rec);
+        }
+    }
+    ok = ok && single.flush() && multi.flush();
+    ring.close();
+
+    if (!ok) {
+        std::fprintf(stderr, "writing to %s failed\n", name);
+        return 1;
+    }
+    std::fprintf(stderr, "shm_feed: %lu samples into %s\n", (unsigned long)samples, name);
+    return 0;
+}
@@ -0,0 +1,259 @@
+#include "shm_ring.h"
+
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+// Polls of an empty ring before the consumer goes to sleep
+static const int SPIN_COUNT = 2000;
+
+// Longest the consumer sleeps before looking again, this bounds the latency
+// for producers that never wake it
+static const long WAIT_TIMEOUT_NS = 1000 * 1000;
+
+#if ATOMIC_LLONG_LOCK_FREE != 2 || ATOMIC_INT_LOCK_FREE != 2
+#error "shm_ring needs lock-free 32 and 64 bit atomics to share them between processes"
+#endif
+
+static void futex_wait(std::atomic<uint32_t> *addr, uint32_t expected) {
+#ifdef __linux__
+    struct timespec timeout = { 0, WAIT_TIMEOUT_NS };
+    syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#else
+    (void)addr;
+    (void)expected;
+    struct timespec timeout = { 0, WAIT_TIMEOUT_NS / 10 };
+    nanosleep(&timeout, nullptr);
+#endif
+}
+
+static void futex_wake(std::atomic<uint32_t> *addr) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    (void)addr;
+#endif
+}
+
+ShmRing::ShmRing()
+    : hdr_(nullptr)
+    , data_(nullptr)
+    , map_size_(0)
+    , owner_(false)
+{
+}
+
+ShmRing::~ShmRing() {
+    if (hdr_) {
+        munmap(hdr_, map_size_);
+    }
+    if (owner_) {
+        shm_unlink(name_.c_str());
+    }
+}
+
+// Map the segment behind fd, the fd is closed either way
+bool ShmRing::map(int fd, size_t size) {
+    void *m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        return false;
+    }
+    hdr_ = (shm_ring_header_t *)m;
+    map_size_ = size;
+    return true;
+}
+
+bool ShmRing::create(const char *name, uint32_t record_size, uint32_t capacity) {
+    // past this the next power of two doesn't fit in the indices
+    if (capacity == 0 || capacity > SHM_RING_MAX_CAPACITY) {
+        return false;
+    }
+    uint32_t cap = 1;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+
+    const size_t data_offset = (sizeof(shm_ring_header_t) + 63) & ~(size_t)63;
+    const size_t size = data_offset + (size_t)cap * record_size;
+
+    // a segment left over from a crashed run would have stale indices
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        ::close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    if (!map(fd, size)) {
+        shm_unlink(name);
+        return false;
+    }
+    name_ = name;
+    owner_ = true;
+
+    // ftruncate zero-fills, so the atomics start out at 0
+    hdr_->version = SHM_RING_VERSION;
+    hdr_->record_size = record_size;
+    hdr_->capacity = cap;
+    hdr_->data_offset = (uint32_t)data_offset;
+    data_ = (uint8_t *)hdr_ + data_offset;
+
+    // magic last, a producer polling for the segment must see the rest first
+    std::atomic_thread_fence(std::memory_order_release);
+    ((std::atomic<uint32_t> *)&hdr_->magic)->store(SHM_RING_MAGIC, std::memory_order_release);
+    return true;
+}
+
+bool ShmRing::attach(const char *name, uint32_t record_size) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_ring_header_t)) {
+        ::close(fd);
+        return false;
+    }
+    if (!map(fd, (size_t)st.st_size)) {
+        return false;
+    }
+
+    const uint32_t magic = ((std::atomic<uint32_t> *)&hdr_->magic)->load(std::memory_order_acquire);
+    if (magic != SHM_RING_MAGIC || hdr_->version != SHM_RING_VERSION ||
+        hdr_->record_size != record_size ||
+        hdr_->data_offset + (size_t)hdr_->capacity * record_size > map_size_) {
+        munmap(hdr_, map_size_);
+        hdr_ = nullptr;
+        return false;
+    }
+    data_ = (uint8_t *)hdr_ + hdr_->data_offset;
+    return true;
+}
+
+bool ShmRing::write(const void *records, size_t count) {
+    if (!hdr_) {
+        return false;
+    }
+    const uint8_t *src = (const uint8_t *)records;
+    const size_t rs = hdr_->record_size;
+    const uint64_t cap = hdr_->capacity;
+
+    uint64_t head = hdr_->head.load(std::memory_order_relaxed);
+    while (count > 0) {
+        uint64_t free_slots = cap - (head - hdr_->tail.load(std::memory_order_acquire));
+        if (free_slots == 0) {
+            // full, the consumer never wakes us so just back off
+            std::this_thread::yield();
+            continue;
+        }
+
+        size_t n = count < free_slots ? count : (size_t)free_slots;
+        size_t slot = (size_t)(head & (cap - 1));
+        size_t first = (size_t)cap - slot;
+        if (first > n) {
+            first = n;
+        }
+        memcpy(data_ + slot * rs, src, first * rs);
+        memcpy(data_, src + first * rs, (n - first) * rs);
+
+        head += n;
+        src += n * rs;
+        count -= n;
+
+        // seq_cst pairs with the consumer setting consumer_waiting and then
+        // re-checking head, one of the two always sees the other
+        hdr_->head.store(head, std::memory_order_seq_cst);
+        if (hdr_->consumer_waiting.load(std::memory_order_seq_cst)) {
+            hdr_->wake_seq.fetch_add(1, std::memory_order_seq_cst);
+            futex_wake(&hdr_->wake_seq);
+        }
+    }
+    return true;
+}
+
+void ShmRing::close() {
+    if (!hdr_) {
+        return;
+    }
+    hdr_->closed.store(1, std::memory_order_seq_cst);
+    hdr_->wake_seq.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake(&hdr_->wake_seq);
+}
+
+void ShmRing::wait_for_data(uint64_t tail) {
+    for (int ix = 0; ix < SPIN_COUNT; ix++) {
+        if (hdr_->head.load(std::memory_order_acquire) != tail ||
+            hdr_->closed.load(std::memory_order_acquire)) {
+            return;
+        }
+    }
+
+    const uint32_t seq = hdr_->wake_seq.load(std::memory_order_seq_cst);
+    hdr_->consumer_waiting.store(1, std::memory_order_seq_cst);
+    if (hdr_->head.load(std::memory_order_seq_cst) == tail &&
+        !hdr_->closed.load(std::memory_order_seq_cst)) {
+        futex_wait(&hdr_->wake_seq, seq);
+    }
+    hdr_->consumer_waiting.store(0, std::memory_order_relaxed);
+}
+
+size_t ShmRing::pending_bytes() const {
+    if (!hdr_) {
+        return 0;
+    }
+    const uint64_t head = hdr_->head.load(std::memory_order_acquire);
+    return (size_t)(head - hdr_->tail.load(std::memory_order_relaxed)) * hdr_->record_size;
+}
+
+size_t ShmRing::read(void *buf, size_t len) {
+    if (!hdr_) {
+        return 0;
+    }
+    const size_t rs = hdr_->record_size;
+    const uint64_t cap = hdr_->capacity;
+    const size_t want = len / rs;
+    if (want == 0) {
+        return 0;
+    }
+
+    const uint64_t tail = hdr_->tail.load(std::memory_order_relaxed);
+    uint64_t head;
+    while ((head = hdr_->head.load(std::memory_order_acquire)) == tail) {
+        if (hdr_->closed.load(std::memory_order_acquire)) {
+            // closed is stored after the last head, so this head is final
+            if (hdr_->head.load(std::memory_order_acquire) == tail) {
+                return 0;
+            }
+            continue;
+        }
+        wait_for_data(tail);
+    }
+
+    size_t n = (size_t)(head - tail);
+    if (n > want) {
+        n = want;
+    }
+    size_t slot = (size_t)(tail & (cap - 1));
+    size_t first = (size_t)cap - slot;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(buf, data_ + slot * rs, first * rs);
+    memcpy((uint8_t *)buf + first * rs, data_, (n - first) * rs);
+
+    hdr_->tail.store(tail + n, std::memory_order_release);
+    return n * rs;
+}
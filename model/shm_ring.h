@@ -0,0 +1,87 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+// Single-producer / single-consumer ring of fixed-size records in a named
+// POSIX shared-memory segment, so a feeder in another process can hand
+// samples to ei_infer without a syscall per batch.
+//
+// The segment is a shm_ring_header_t followed by `capacity` records. `head`
+// counts records ever written (only the producer stores it), `tail` counts
+// records ever read (only the consumer stores it); both only grow, the slot
+// of record n is n % capacity. A producer publishes by copying records into
+// the free slots and then storing the new head with release semantics.
+//
+// The consumer spins briefly when the ring is empty and then sleeps on a
+// futex (Linux) or polls (elsewhere). A producer that wants to wake it right
+// away bumps `wake_seq` and futex-wakes it when `consumer_waiting` is set;
+// producers that don't are still picked up within the wait timeout.
+//
+// shm_feed.cpp is a producer that publishes mic,imu lines from stdin.
+
+#define SHM_RING_MAGIC      0x42524945u // "EIRB" in memory
+#define SHM_RING_VERSION    1
+#define SHM_RING_MAX_CAPACITY   (1u << 31)  // largest power of two in a uint32_t
+
+struct shm_ring_header_t {
+    uint32_t magic;             // SHM_RING_MAGIC once the segment is ready
+    uint32_t version;           // SHM_RING_VERSION
+    uint32_t record_size;       // bytes per record
+    uint32_t capacity;          // records, a power of two
+    uint32_t data_offset;       // offset of the first record from the segment start
+    uint32_t reserved[11];
+
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> wake_seq;         // futex word
+    std::atomic<uint32_t> consumer_waiting;
+    std::atomic<uint32_t> closed;                       // producer is done
+};
+
+class ShmRing {
+public:
+    ShmRing();
+    ~ShmRing();
+
+    // Consumer side: create (or replace) the segment `name`, e.g. "/ei_infer".
+    // capacity is rounded up to a power of two, 1..SHM_RING_MAX_CAPACITY.
+    bool create(const char *name, uint32_t record_size, uint32_t capacity);
+
+    // Producer side: attach to a segment made by create()
+    bool attach(const char *name, uint32_t record_size);
+
+    // Producer: copy `count` records in, waiting for room if the ring is full.
+    // Returns false if the ring isn't open.
+    bool write(const void *records, size_t count);
+
+    // Producer: tell the consumer no more records are coming
+    void close();
+
+    // Consumer: copy up to `len` bytes (whole records only) into buf,
+    // blocking until at least one record is there. Returns the number of
+    // bytes copied, 0 once the producer has closed and the ring is drained.
+    // Same contract as read(), so it can replace stdin as a record source.
+    size_t read(void *buf, size_t len);
+
+    uint32_t record_size() const { return hdr_ ? hdr_->record_size : 0; }
+
+    // Consumer: bytes written by the producer but not read yet
+    size_t pending_bytes() const;
+
+private:
+    bool map(int fd, size_t size);
+    void wait_for_data(uint64_t tail);
+
+    shm_ring_header_t *hdr_;
+    uint8_t *data_;
+    size_t map_size_;
+    std::string name_;
+    bool owner_;
+};
+
+#endif // SHM_RING_H
@@ -36,6 +36,11 @@
 #include "edge-impulse-sdk/tensorflow/lite/c/common.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/micro_mutable_op_resolver.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
+#if EI_CLASSIFIER_TFLITE_FUSED_GRAPH == 1 && !EI_CLASSIFIER_PRINT_STATE
+#include "edge-impulse-sdk/tensorflow/lite/kernels/internal/optimized/integer_ops/fused_layers.h"
+#include "edge-impulse-sdk/tensorflow/lite/micro/kernels/fully_connected.h"
+#endif
 
 #if EI_CLASSIFIER_PRINT_STATE
 #if defined(__cplusplus) && EI_C_LINKAGE == 1
@@ -113,12 +118,10 @@ uint8_t tensor_arena[kTensorArenaSize] ALIGN(16);
 uint8_t tensor_arena[kTensorArenaSize] ALIGN(16) __attribute__((section(".tensor_arena")));
 #else
 #define EI_CLASSIFIER_ALLOCATION_HEAP 1
+// stays NULL: tensorData below holds offsets into each instance's own arena
 uint8_t* tensor_arena = NULL;
 #endif
 
-static uint8_t* tensor_boundary;
-static uint8_t* current_location;
-
 template <int SZ, class T> struct TfArray {
   int sz; T elem[SZ];
 };
@@ -146,12 +149,8 @@ typedef struct {
   int16_t index;
 } TfLiteEvalTensorWithIndex;
 
-TfLiteContext ctx{};
 static const int MAX_TFL_TENSOR_COUNT = 4;
-static TfLiteTensorWithIndex tflTensors[MAX_TFL_TENSOR_COUNT];
 static const int MAX_TFL_EVAL_COUNT = 4;
-static TfLiteEvalTensorWithIndex tflEvalTensors[MAX_TFL_EVAL_COUNT];
-TfLiteRegistration registrations[OP_LAST];
 
 namespace g0 {
 const TfArray<2, int> tensor_dimension0 = { 2, { 1,382 } };
@@ -259,15 +258,16 @@ TensorInfo_t tensorData[] = {
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension9, 2, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant10))}, },
 };
 
+// Node table as generated, every instance works on its own copy (init sets user_data)
 #ifndef TF_LITE_STATIC_MEMORY
-TfLiteNode tflNodes[4] = {
+const TfLiteNode tflNodes[4] = {
 { (TfLiteIntArray*)&g0::inputs0, (TfLiteIntArray*)&g0::outputs0, (TfLiteIntArray*)&g0::inputs0, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata0)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs1, (TfLiteIntArray*)&g0::outputs1, (TfLiteIntArray*)&g0::inputs1, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata1)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs2, (TfLiteIntArray*)&g0::outputs2, (TfLiteIntArray*)&g0::inputs2, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata2)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs3, (TfLiteIntArray*)&g0::outputs3, (TfLiteIntArray*)&g0::inputs3, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata3)), nullptr, 0, },
 };
 #else
-TfLiteNode tflNodes[4] = {
+const TfLiteNode tflNodes[4] = {
 { (TfLiteIntArray*)&g0::inputs0, (TfLiteIntArray*)&g0::outputs0, (TfLiteIntArray*)&g0::inputs0, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata0)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs1, (TfLiteIntArray*)&g0::outputs1, (TfLiteIntArray*)&g0::inputs1, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata1)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs2, (TfLiteIntArray*)&g0::outputs2, (TfLiteIntArray*)&g0::inputs2, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata2)), nullptr, 0, },
@@ -292,24 +292,71 @@ static const int out_tensor_indices[] = {
   10, 
 };
 
+typedef struct {
+  size_t bytes;
+  void *ptr;
+} scratch_buffer_t;
+
+static const uint16_t TENSOR_IX_UNUSED = 0x7FFF;
+static const int MAX_BATCH_DIMS = 5;
+
+// Everything an inference writes to: the arena, and the node and tensor
+// tables pointing into it. The weights and tensorData are read-only and
+// shared, so threads can run the model at the same time on their own
+// instances. `ctx` comes first, the context callbacks get the instance
+// back from the context pointer.
+struct EonInstance {
+  TfLiteContext ctx;
+  uint8_t* tensor_arena;
+  uint8_t* tensor_boundary;
+  uint8_t* current_location;
+  TfLiteTensorWithIndex tflTensors[MAX_TFL_TENSOR_COUNT];
+  TfLiteEvalTensorWithIndex tflEvalTensors[MAX_TFL_EVAL_COUNT];
+  TfLiteRegistration registrations[OP_LAST];
+  TfLiteNode tflNodes[4];
+  size_t current_subgraph_index;
+  void* overflow_buffers[EI_MAX_OVERFLOW_BUFFER_COUNT];
+  size_t overflow_buffers_ix;
+  scratch_buffer_t scratch_buffers[EI_MAX_SCRATCH_BUFFER_COUNT];
+  size_t scratch_buffers_ix;
+  // Batched invoke: every arena tensor gets `batch_count` rows in `batch_arena`,
+  // placed at `batch_count` times its offset in the tensor arena, so tensors
+  // that don't overlap in the arena plan don't overlap in the batch arena either.
+  size_t batch_count;
+  uint8_t* batch_arena;
+  TfArray<MAX_BATCH_DIMS, int> batch_dims[MAX_TFL_EVAL_COUNT];
+};
 
-size_t current_subgraph_index = 0;
+// the instance behind the tflite_learn_796726_5_init() / _invoke() / ... API
+static EonInstance default_instance;
 
-static void init_tflite_tensor(size_t i, TfLiteTensor *tensor) {
+#ifndef EI_CLASSIFIER_ALLOCATION_HEAP
+// With a static arena default_instance is the only instance there is, and
+// _init_instance() hands it out too. Whoever inits it owns it until reset, a
+// second init (another handle keeping the model, or the global API) fails
+// instead of sharing the context.
+static bool default_instance_claimed = false;
+#endif
+
+static EonInstance* get_instance(const struct TfLiteContext* context) {
+  return (EonInstance*)context;
+}
+
+static void init_tflite_tensor(EonInstance* inst, size_t i, TfLiteTensor *tensor) {
   tensor->type = tensorData[i].type;
   tensor->is_variable = false;
 
 #if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
   tensor->allocation_type = tensorData[i].allocation_type;
 #else
-  tensor->allocation_type = (tensor_arena <= tensorData[i].data && tensorData[i].data < tensor_arena + kTensorArenaSize) ? kTfLiteArenaRw : kTfLiteMmapRo;
+  tensor->allocation_type = (inst->tensor_arena <= tensorData[i].data && tensorData[i].data < inst->tensor_arena + kTensorArenaSize) ? kTfLiteArenaRw : kTfLiteMmapRo;
 #endif
   tensor->bytes = tensorData[i].bytes;
   tensor->dims = tensorData[i].dims;
 
 #if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
   if(tensor->allocation_type == kTfLiteArenaRw){
-    uint8_t* start = (uint8_t*) ((uintptr_t)tensorData[i].data + (uintptr_t) tensor_arena);
+    uint8_t* start = (uint8_t*) ((uintptr_t)tensorData[i].data + (uintptr_t) inst->tensor_arena);
 
     tensor->data.data =  start;
   }
@@ -328,7 +375,7 @@ static void init_tflite_tensor(size_t i, TfLiteTensor *tensor) {
 
 }
 
-static void init_tflite_eval_tensor(int i, TfLiteEvalTensor *tensor) {
+static void init_tflite_eval_tensor(EonInstance* inst, int i, TfLiteEvalTensor *tensor) {
 
   tensor->type = tensorData[i].type;
 
@@ -337,7 +384,7 @@ static void init_tflite_eval_tensor(int i, TfLiteEvalTensor *tensor) {
 #if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
   auto allocation_type = tensorData[i].allocation_type;
   if(allocation_type == kTfLiteArenaRw) {
-    uint8_t* start = (uint8_t*) ((uintptr_t)tensorData[i].data + (uintptr_t) tensor_arena);
+    uint8_t* start = (uint8_t*) ((uintptr_t)tensorData[i].data + (uintptr_t) inst->tensor_arena);
 
     tensor->data.data =  start;
   }
@@ -349,15 +396,14 @@ static void init_tflite_eval_tensor(int i, TfLiteEvalTensor *tensor) {
 #endif // EI_CLASSIFIER_ALLOCATION_HEAP
 }
 
-static void* overflow_buffers[EI_MAX_OVERFLOW_BUFFER_COUNT];
-static size_t overflow_buffers_ix = 0;
 static void * AllocatePersistentBufferImpl(struct TfLiteContext* ctx,
                                        size_t bytes) {
+  EonInstance* inst = get_instance(ctx);
   void *ptr;
   uint32_t align_bytes = (bytes % 16) ? 16 - (bytes % 16) : 0;
 
-  if (current_location - (bytes + align_bytes) < tensor_boundary) {
-    if (overflow_buffers_ix > EI_MAX_OVERFLOW_BUFFER_COUNT - 1) {
+  if (inst->current_location - (bytes + align_bytes) < inst->tensor_boundary) {
+    if (inst->overflow_buffers_ix > EI_MAX_OVERFLOW_BUFFER_COUNT - 1) {
       ei_printf("ERR: Failed to allocate persistent buffer of size %d, does not fit in tensor arena and reached EI_MAX_OVERFLOW_BUFFER_COUNT\n",
         (int)bytes);
       return NULL;
@@ -370,33 +416,26 @@ static void * AllocatePersistentBufferImpl(struct TfLiteContext* ctx,
       ei_printf("ERR: Failed to allocate persistent buffer of size %d\n", (int)bytes);
       return NULL;
     }
-    overflow_buffers[overflow_buffers_ix++] = ptr;
+    inst->overflow_buffers[inst->overflow_buffers_ix++] = ptr;
     return ptr;
   }
 
-  current_location -= bytes;
+  inst->current_location -= bytes;
 
   // align to the left aligned boundary of 16 bytes
-  current_location -= 15; // for alignment
-  current_location += 16 - ((uintptr_t)(current_location) & 15);
+  inst->current_location -= 15; // for alignment
+  inst->current_location += 16 - ((uintptr_t)(inst->current_location) & 15);
 
-  ptr = current_location;
+  ptr = inst->current_location;
   memset(ptr, 0, bytes);
 
   return ptr;
 }
 
-typedef struct {
-  size_t bytes;
-  void *ptr;
-} scratch_buffer_t;
-
-static scratch_buffer_t scratch_buffers[EI_MAX_SCRATCH_BUFFER_COUNT];
-static size_t scratch_buffers_ix = 0;
-
 static TfLiteStatus RequestScratchBufferInArenaImpl(struct TfLiteContext* ctx, size_t bytes,
                                                 int* buffer_idx) {
-  if (scratch_buffers_ix > EI_MAX_SCRATCH_BUFFER_COUNT - 1) {
+  EonInstance* inst = get_instance(ctx);
+  if (inst->scratch_buffers_ix > EI_MAX_SCRATCH_BUFFER_COUNT - 1) {
     ei_printf("ERR: Failed to allocate scratch buffer of size %d, reached EI_MAX_SCRATCH_BUFFER_COUNT\n",
       (int)bytes);
     return kTfLiteError;
@@ -412,48 +451,178 @@ static TfLiteStatus RequestScratchBufferInArenaImpl(struct TfLiteContext* ctx, s
     return kTfLiteError;
   }
 
-  scratch_buffers[scratch_buffers_ix] = b;
-  *buffer_idx = scratch_buffers_ix;
+  inst->scratch_buffers[inst->scratch_buffers_ix] = b;
+  *buffer_idx = inst->scratch_buffers_ix;
 
-  scratch_buffers_ix++;
+  inst->scratch_buffers_ix++;
 
   return kTfLiteOk;
 }
 
 static void* GetScratchBufferImpl(struct TfLiteContext* ctx, int buffer_idx) {
-  if (buffer_idx > (int)scratch_buffers_ix) {
+  EonInstance* inst = get_instance(ctx);
+  if (buffer_idx > (int)inst->scratch_buffers_ix) {
     return NULL;
   }
-  return scratch_buffers[buffer_idx].ptr;
+  return inst->scratch_buffers[buffer_idx].ptr;
 }
 
-static const uint16_t TENSOR_IX_UNUSED = 0x7FFF;
+// Where tensor i lives in the arena plan. With a static arena tensorData
+// points into it, which is why there's only one instance then.
+static bool is_arena_tensor(size_t i) {
+#if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
+  return tensorData[i].allocation_type == kTfLiteArenaRw;
+#else
+  return tensor_arena <= tensorData[i].data && tensorData[i].data < tensor_arena + kTensorArenaSize;
+#endif
+}
+
+static size_t arena_offset(size_t i) {
+#if defined(EI_CLASSIFIER_ALLOCATION_HEAP)
+  return (uintptr_t)tensorData[i].data;
+#else
+  return (uint8_t*)tensorData[i].data - tensor_arena;
+#endif
+}
+
+static void init_batch_eval_tensor(EonInstance* inst, size_t i, TfLiteEvalTensor *tensor, TfArray<MAX_BATCH_DIMS, int> *dims) {
+  if (!is_arena_tensor(i)) {
+    return;
+  }
+  dims->sz = tensorData[i].dims->size;
+  for (int ix = 0; ix < dims->sz; ix++) {
+    dims->elem[ix] = tensorData[i].dims->data[ix];
+  }
+  dims->elem[0] *= inst->batch_count;
+  tensor->dims = (TfLiteIntArray*)dims;
+  tensor->data.data = inst->batch_arena + arena_offset(i) * inst->batch_count;
+}
+
+#if EI_CLASSIFIER_TFLITE_FUSED_GRAPH == 1 && !EI_CLASSIFIER_PRINT_STATE
+// The graph as one function: FC(382->20, relu) -> FC(20->10, relu) ->
+// FC(10->2) -> softmax, with the activations on the stack. The parameters are
+// what Prepare derives from the tensor scales and zero points, init_instance
+// checks them (and the shapes) against what Prepare actually came up with.
+#define EI_TFLITE_FUSED_INVOKE 1
+
+namespace fused {
+const FullyConnectedParams fc0 = { 25, 0, -128, 1489043882, -8, -128, 127, 0.0f, 0.0f, false, false, FullyConnectedWeightsFormat::kDefault };
+const FullyConnectedParams fc1 = { 128, 0, -128, 1367527505, -8, -128, 127, 0.0f, 0.0f, false, false, FullyConnectedWeightsFormat::kDefault };
+const FullyConnectedParams fc2 = { 128, 0, -16, 1484261529, -7, -128, 127, 0.0f, 0.0f, false, false, FullyConnectedWeightsFormat::kDefault };
+const SoftmaxParams softmax3 = { 1.0, 1890374528, 22, 0, 0, -496, 0, 0.0f, nullptr, nullptr, nullptr, nullptr, nullptr };
+
+// rows per pass through the layers
+static const size_t ROWS = 16;
+
+static void invoke(size_t batches, const int8_t *input, int8_t *output) {
+  int8_t act0[ROWS * 20];
+  int8_t act1[ROWS * 10];
+  int8_t act2[ROWS * 2];
+
+  for (size_t row = 0; row < batches; row += ROWS) {
+    const int rows = (int)(batches - row < ROWS ? batches - row : ROWS);
+    optimized_integer_ops::fused::FullyConnected<382, 20>(fc0, rows, input + row * 382, g0::tensor_data6, g0::tensor_data5, act0);
+    optimized_integer_ops::fused::FullyConnected<20, 10>(fc1, rows, act0, g0::tensor_data4, g0::tensor_data3, act1);
+    optimized_integer_ops::fused::FullyConnected<10, 2>(fc2, rows, act1, g0::tensor_data2, g0::tensor_data1, act2);
+    optimized_integer_ops::fused::Softmax<2>(softmax3, rows, act2, output + row * 2);
+  }
+}
 
-static void ResetTensors() {
+static const int depth[4] = { 382, 20, 10, 2 };
+
+static int last_dim(int tensor) {
+  const TfLiteIntArray *dims = tensorData[tensor].dims;
+  return dims->size > 0 ? dims->data[dims->size - 1] : 0;
+}
+
+// FC node `layer`: shapes, weights and bias as in invoke(), and the OpData
+// Prepare left in user_data (the reference kernel keeps OpDataFullyConnected
+// first) gives the same parameters
+static bool fc_matches(const TfLiteNode &node, int layer, const FullyConnectedParams &params,
+                       const void *weights, const void *bias) {
+  if (used_ops[layer] != OP_FULLY_CONNECTED || node.inputs->size < 3 ||
+      node.inputs->data[2] < 0 || node.user_data == nullptr) {
+    return false;
+  }
+  const TfLiteIntArray *filter = tensorData[node.inputs->data[1]].dims;
+  if (last_dim(node.inputs->data[0]) != depth[layer] || filter->size != 2 ||
+      filter->data[0] != depth[layer + 1] || filter->data[1] != depth[layer] ||
+      last_dim(node.outputs->data[0]) != depth[layer + 1] ||
+      tensorData[node.inputs->data[1]].data != weights ||
+      tensorData[node.inputs->data[2]].data != bias) {
+    return false;
+  }
+  const OpDataFullyConnected &op = *(const OpDataFullyConnected *)node.user_data;
+  return params.input_offset == -op.input_zero_point &&
+         params.weights_offset == -op.filter_zero_point &&
+         params.output_offset == op.output_zero_point &&
+         params.output_multiplier == op.output_multiplier &&
+         params.output_shift == op.output_shift &&
+         params.quantized_activation_min == op.output_activation_min &&
+         params.quantized_activation_max == op.output_activation_max;
+}
+
+// After Prepare: does the model still match the constants above? A
+// regenerated model or an edited scale / zero point must not run through
+// invoke() with stale numbers.
+static bool matches_model(const EonInstance *inst) {
+  const TfLiteNode *nodes = inst->tflNodes;
+  for (int layer = 0; layer < 4; layer++) {
+    const int input = layer == 0 ? in_tensor_indices[0] : nodes[layer - 1].outputs->data[0];
+    if (nodes[layer].inputs->size < 1 || nodes[layer].inputs->data[0] != input ||
+        nodes[layer].outputs->size != 1) {
+      return false;
+    }
+  }
+  if (nodes[3].outputs->data[0] != out_tensor_indices[0]) {
+    return false;
+  }
+
+  if (!fc_matches(nodes[0], 0, fc0, g0::tensor_data6, g0::tensor_data5) ||
+      !fc_matches(nodes[1], 1, fc1, g0::tensor_data4, g0::tensor_data3) ||
+      !fc_matches(nodes[2], 2, fc2, g0::tensor_data2, g0::tensor_data1)) {
+    return false;
+  }
+
+  if (used_ops[3] != OP_SOFTMAX || nodes[3].user_data == nullptr ||
+      last_dim(nodes[3].inputs->data[0]) != depth[3] ||
+      last_dim(nodes[3].outputs->data[0]) != depth[3]) {
+    return false;
+  }
+  const SoftmaxParams &op = *(const SoftmaxParams *)nodes[3].user_data;
+  return softmax3.input_multiplier == op.input_multiplier &&
+         softmax3.input_left_shift == op.input_left_shift &&
+         softmax3.diff_min == op.diff_min;
+}
+} // namespace fused
+#endif // EI_CLASSIFIER_TFLITE_FUSED_GRAPH
+
+static void ResetTensors(EonInstance* inst) {
   for (size_t ix = 0; ix < MAX_TFL_TENSOR_COUNT; ix++) {
-    tflTensors[ix].index = TENSOR_IX_UNUSED;
+    inst->tflTensors[ix].index = TENSOR_IX_UNUSED;
   }
   for (size_t ix = 0; ix < MAX_TFL_EVAL_COUNT; ix++) {
-    tflEvalTensors[ix].index = TENSOR_IX_UNUSED;
+    inst->tflEvalTensors[ix].index = TENSOR_IX_UNUSED;
   }
 }
 
 static TfLiteTensor* GetTensorImpl(const struct TfLiteContext* context,
                                int tensor_idx) {
+  EonInstance* inst = get_instance(context);
 
-  tensor_idx = tflTensors_subgraph_index[current_subgraph_index] + tensor_idx;
+  tensor_idx = tflTensors_subgraph_index[inst->current_subgraph_index] + tensor_idx;
 
   for (size_t ix = 0; ix < MAX_TFL_TENSOR_COUNT; ix++) {
     // already used? OK!
-    if (tflTensors[ix].index == tensor_idx) {
-      return &tflTensors[ix].tensor;
+    if (inst->tflTensors[ix].index == tensor_idx) {
+      return &inst->tflTensors[ix].tensor;
     }
     // passed all the ones we've used, so end of the list?
-    if (tflTensors[ix].index == TENSOR_IX_UNUSED) {
+    if (inst->tflTensors[ix].index == TENSOR_IX_UNUSED) {
       // init the tensor
-      init_tflite_tensor(tensor_idx, &tflTensors[ix].tensor);
-      tflTensors[ix].index = tensor_idx;
-      return &tflTensors[ix].tensor;
+      init_tflite_tensor(inst, tensor_idx, &inst->tflTensors[ix].tensor);
+      inst->tflTensors[ix].index = tensor_idx;
+      return &inst->tflTensors[ix].tensor;
     }
   }
 
@@ -463,20 +632,24 @@ static TfLiteTensor* GetTensorImpl(const struct TfLiteContext* context,
 
 static TfLiteEvalTensor* GetEvalTensorImpl(const struct TfLiteContext* context,
                                        int tensor_idx) {
+  EonInstance* inst = get_instance(context);
 
-  tensor_idx = tflTensors_subgraph_index[current_subgraph_index] + tensor_idx;
+  tensor_idx = tflTensors_subgraph_index[inst->current_subgraph_index] + tensor_idx;
 
   for (size_t ix = 0; ix < MAX_TFL_EVAL_COUNT; ix++) {
     // already used? OK!
-    if (tflEvalTensors[ix].index == tensor_idx) {
-      return &tflEvalTensors[ix].tensor;
+    if (inst->tflEvalTensors[ix].index == tensor_idx) {
+      return &inst->tflEvalTensors[ix].tensor;
     }
     // passed all the ones we've used, so end of the list?
-    if (tflEvalTensors[ix].index == TENSOR_IX_UNUSED) {
+    if (inst->tflEvalTensors[ix].index == TENSOR_IX_UNUSED) {
       // init the tensor
-      init_tflite_eval_tensor(tensor_idx, &tflEvalTensors[ix].tensor);
-      tflEvalTensors[ix].index = tensor_idx;
-      return &tflEvalTensors[ix].tensor;
+      init_tflite_eval_tensor(inst, tensor_idx, &inst->tflEvalTensors[ix].tensor);
+      if (inst->batch_count > 0) {
+        init_batch_eval_tensor(inst, tensor_idx, &inst->tflEvalTensors[ix].tensor, &inst->batch_dims[ix]);
+      }
+      inst->tflEvalTensors[ix].index = tensor_idx;
+      return &inst->tflEvalTensors[ix].tensor;
     }
   }
 
@@ -487,23 +660,23 @@ static TfLiteEvalTensor* GetEvalTensorImpl(const struct TfLiteContext* context,
 class EonMicroContext : public MicroContext {
  public:
  
-  EonMicroContext(): MicroContext(nullptr, nullptr, nullptr) { }
+  EonMicroContext(EonInstance* inst): MicroContext(nullptr, nullptr, nullptr), ctx_(&inst->ctx) { }
 
   void* AllocatePersistentBuffer(size_t bytes) {
-    return AllocatePersistentBufferImpl(nullptr, bytes);
+    return AllocatePersistentBufferImpl(ctx_, bytes);
   }
 
   TfLiteStatus RequestScratchBufferInArena(size_t bytes,
                                            int* buffer_index) {
-  return RequestScratchBufferInArenaImpl(nullptr, bytes, buffer_index);
+  return RequestScratchBufferInArenaImpl(ctx_, bytes, buffer_index);
   }
 
   void* GetScratchBuffer(int buffer_index) {
-    return GetScratchBufferImpl(nullptr, buffer_index);
+    return GetScratchBufferImpl(ctx_, buffer_index);
   }
  
   TfLiteTensor* AllocateTempTfLiteTensor(int tensor_index) {
-    return GetTensorImpl(nullptr, tensor_index);
+    return GetTensorImpl(ctx_, tensor_index);
   }
 
   void DeallocateTempTfLiteTensor(TfLiteTensor* tensor) {
@@ -515,28 +688,35 @@ class EonMicroContext : public MicroContext {
   }
 
   TfLiteEvalTensor* GetEvalTensor(int tensor_index) {
-    return GetEvalTensorImpl(nullptr, tensor_index);
+    return GetEvalTensorImpl(ctx_, tensor_index);
   }
 
+ private:
+  TfLiteContext* ctx_;
 };
 
-
-} // namespace
-
-TfLiteStatus tflite_learn_796726_5_init( void*(*alloc_fnc)(size_t,size_t) ) {
+static TfLiteStatus init_instance(EonInstance* inst, void*(*alloc_fnc)(size_t,size_t)) {
 #ifdef EI_CLASSIFIER_ALLOCATION_HEAP
-  tensor_arena = (uint8_t*) alloc_fnc(16, kTensorArenaSize);
-  if (!tensor_arena) {
+  inst->tensor_arena = (uint8_t*) alloc_fnc(16, kTensorArenaSize);
+  if (!inst->tensor_arena) {
     ei_printf("ERR: failed to allocate tensor arena\n");
     return kTfLiteError;
   }
 #else
-  memset(tensor_arena, 0, kTensorArenaSize);
+  inst->tensor_arena = tensor_arena;
+  memset(inst->tensor_arena, 0, kTensorArenaSize);
 #endif
-  tensor_boundary = tensor_arena;
-  current_location = tensor_arena + kTensorArenaSize;
-
-  EonMicroContext micro_context_;
+  inst->tensor_boundary = inst->tensor_arena;
+  inst->current_location = inst->tensor_arena + kTensorArenaSize;
+  inst->current_subgraph_index = 0;
+  inst->scratch_buffers_ix = 0;
+  inst->overflow_buffers_ix = 0;
+  inst->batch_count = 0;
+  inst->batch_arena = NULL;
+  memcpy(inst->tflNodes, tflNodes, sizeof(tflNodes));
+
+  EonMicroContext micro_context_(inst);
+  TfLiteContext &ctx = inst->ctx;
   
   // Set microcontext as the context ptr
   ctx.impl_ = static_cast<void*>(&micro_context_);
@@ -551,76 +731,79 @@ TfLiteStatus tflite_learn_796726_5_init( void*(*alloc_fnc)(size_t,size_t) ) {
   ctx.tensors_size = 11;
   for (size_t i = 0; i < 11; ++i) {
     TfLiteTensor tensor;
-    init_tflite_tensor(i, &tensor);
+    init_tflite_tensor(inst, i, &tensor);
     if (tensor.allocation_type == kTfLiteArenaRw) {
       auto data_end_ptr = (uint8_t*)tensor.data.data + tensorData[i].bytes;
-      if (data_end_ptr > tensor_boundary) {
-        tensor_boundary = data_end_ptr;
+      if (data_end_ptr > inst->tensor_boundary) {
+        inst->tensor_boundary = data_end_ptr;
       }
     }
   }
 
-  if (tensor_boundary > current_location /* end of arena size */) {
+  if (inst->tensor_boundary > inst->current_location /* end of arena size */) {
     ei_printf("ERR: tensor arena is too small, does not fit model - even without scratch buffers\n");
     return kTfLiteError;
   }
 
-  registrations[OP_FULLY_CONNECTED] = Register_FULLY_CONNECTED();
-  registrations[OP_SOFTMAX] = Register_SOFTMAX();
+  inst->registrations[OP_FULLY_CONNECTED] = Register_FULLY_CONNECTED();
+  inst->registrations[OP_SOFTMAX] = Register_SOFTMAX();
 
   for (size_t g = 0; g < 1; ++g) {
-    current_subgraph_index = g;
+    inst->current_subgraph_index = g;
     for(size_t i = tflNodes_subgraph_index[g]; i < tflNodes_subgraph_index[g+1]; ++i) {
-      if (registrations[used_ops[i]].init) {
-        tflNodes[i].user_data = registrations[used_ops[i]].init(&ctx, (const char*)tflNodes[i].builtin_data, 0);
+      if (inst->registrations[used_ops[i]].init) {
+        inst->tflNodes[i].user_data = inst->registrations[used_ops[i]].init(&ctx, (const char*)inst->tflNodes[i].builtin_data, 0);
       }
     }
   }
-  current_subgraph_index = 0;
+  inst->current_subgraph_index = 0;
 
   for(size_t g = 0; g < 1; ++g) {
-    current_subgraph_index = g;
+    inst->current_subgraph_index = g;
     for(size_t i = tflNodes_subgraph_index[g]; i < tflNodes_subgraph_index[g+1]; ++i) {
-      if (registrations[used_ops[i]].prepare) {
-        ResetTensors();
-        TfLiteStatus status = registrations[used_ops[i]].prepare(&ctx, &tflNodes[i]);
+      if (inst->registrations[used_ops[i]].prepare) {
+        ResetTensors(inst);
+        TfLiteStatus status = inst->registrations[used_ops[i]].prepare(&ctx, &inst->tflNodes[i]);
         if (status != kTfLiteOk) {
           return status;
         }
       }
     }
   }
-  current_subgraph_index = 0;
+  inst->current_subgraph_index = 0;
 
-  return kTfLiteOk;
-}
+#if defined(EI_TFLITE_FUSED_INVOKE)
+  if (!fused::matches_model(inst)) {
+    ei_printf("ERR: fused graph does not match the prepared model\n");
+    return kTfLiteError;
+  }
+#endif
 
-TfLiteStatus tflite_learn_796726_5_input(int index, TfLiteTensor *tensor) {
-  init_tflite_tensor(in_tensor_indices[index], tensor);
   return kTfLiteOk;
 }
 
-TfLiteStatus tflite_learn_796726_5_output(int index, TfLiteTensor *tensor) {
-  init_tflite_tensor(out_tensor_indices[index], tensor);
+static TfLiteStatus invoke_instance(EonInstance* inst) {
+#if defined(EI_TFLITE_FUSED_INVOKE)
+  fused::invoke(1, (const int8_t*)(inst->tensor_arena + arena_offset(in_tensor_indices[0])),
+                (int8_t*)(inst->tensor_arena + arena_offset(out_tensor_indices[0])));
   return kTfLiteOk;
-}
+#else
 
-TfLiteStatus tflite_learn_796726_5_invoke() {
   for (size_t i = 0; i < 4; ++i) {
-    ResetTensors();
+    ResetTensors(inst);
 
-    TfLiteStatus status = registrations[used_ops[i]].invoke(&ctx, &tflNodes[i]);
+    TfLiteStatus status = inst->registrations[used_ops[i]].invoke(&inst->ctx, &inst->tflNodes[i]);
 
 #if EI_CLASSIFIER_PRINT_STATE
     ei_printf("layer %lu\n", i);
     ei_printf("    inputs:\n");
-    for (size_t ix = 0; ix < tflNodes[i].inputs->size; ix++) {
-      auto d = tensorData[tflNodes[i].inputs->data[ix]];
+    for (size_t ix = 0; ix < inst->tflNodes[i].inputs->size; ix++) {
+      auto d = tensorData[inst->tflNodes[i].inputs->data[ix]];
 
       size_t data_ptr = (size_t)d.data;
 
       if (d.allocation_type == kTfLiteArenaRw) {
-        data_ptr = (size_t)tensor_arena + data_ptr;
+        data_ptr = (size_t)inst->tensor_arena + data_ptr;
       }
 
       if (d.type == TfLiteType::kTfLiteInt8) {
@@ -642,13 +825,13 @@ TfLiteStatus tflite_learn_796726_5_invoke() {
     ei_printf("\n");
 
     ei_printf("    outputs:\n");
-    for (size_t ix = 0; ix < tflNodes[i].outputs->size; ix++) {
-      auto d = tensorData[tflNodes[i].outputs->data[ix]];
+    for (size_t ix = 0; ix < inst->tflNodes[i].outputs->size; ix++) {
+      auto d = tensorData[inst->tflNodes[i].outputs->data[ix]];
 
       size_t data_ptr = (size_t)d.data;
 
       if (d.allocation_type == kTfLiteArenaRw) {
-        data_ptr = (size_t)tensor_arena + data_ptr;
+        data_ptr = (size_t)inst->tensor_arena + data_ptr;
       }
 
       if (d.type == TfLiteType::kTfLiteInt8) {
@@ -675,20 +858,170 @@ TfLiteStatus tflite_learn_796726_5_invoke() {
     }
   }
   return kTfLiteOk;
+#endif // EI_TFLITE_FUSED_INVOKE
 }
 
-TfLiteStatus tflite_learn_796726_5_reset( void (*free_fnc)(void* ptr) ) {
+static TfLiteStatus invoke_batch_instance(EonInstance* inst, size_t batches, uint8_t *arena, const void *input, void *output) {
+#if defined(EI_TFLITE_FUSED_INVOKE)
+  fused::invoke(batches, (const int8_t*)input, (int8_t*)output);
+  return kTfLiteOk;
+#else
+
+  // all arena tensors need a leading batch dimension of 1 to be stacked
+  for (size_t i = 0; i < 11; ++i) {
+    if (is_arena_tensor(i) &&
+        (tensorData[i].dims->size < 1 || tensorData[i].dims->size > MAX_BATCH_DIMS || tensorData[i].dims->data[0] != 1)) {
+      ei_printf("ERR: model does not support batched inference\n");
+      return kTfLiteError;
+    }
+  }
+
+  const int in_ix = in_tensor_indices[0];
+  const int out_ix = out_tensor_indices[0];
+  memcpy(arena + arena_offset(in_ix) * batches, input, tensorData[in_ix].bytes * batches);
+
+  inst->batch_count = batches;
+  inst->batch_arena = arena;
+
+  TfLiteStatus status = kTfLiteOk;
+  for (size_t i = 0; i < 4; ++i) {
+    ResetTensors(inst);
+
+    status = inst->registrations[used_ops[i]].invoke(&inst->ctx, &inst->tflNodes[i]);
+    if (status != kTfLiteOk) {
+      break;
+    }
+  }
+
+  inst->batch_count = 0;
+  inst->batch_arena = NULL;
+  ResetTensors(inst);
+
+  if (status == kTfLiteOk) {
+    memcpy(output, arena + arena_offset(out_ix) * batches, tensorData[out_ix].bytes * batches);
+  }
+  return status;
+#endif // EI_TFLITE_FUSED_INVOKE
+}
+
+static TfLiteStatus reset_instance(EonInstance* inst, void (*free_fnc)(void* ptr)) {
 #ifdef EI_CLASSIFIER_ALLOCATION_HEAP
-  free_fnc(tensor_arena);
+  free_fnc(inst->tensor_arena);
+  inst->tensor_arena = NULL;
 #endif
 
   // scratch buffers are allocated within the arena, so just reset the counter so memory can be reused
-  scratch_buffers_ix = 0;
+  inst->scratch_buffers_ix = 0;
 
   // overflow buffers are on the heap, so free them first
-  for (size_t ix = 0; ix < overflow_buffers_ix; ix++) {
-    ei_free(overflow_buffers[ix]);
+  for (size_t ix = 0; ix < inst->overflow_buffers_ix; ix++) {
+    ei_free(inst->overflow_buffers[ix]);
   }
-  overflow_buffers_ix = 0;
+  inst->overflow_buffers_ix = 0;
   return kTfLiteOk;
 }
+
+#ifndef EI_CLASSIFIER_ALLOCATION_HEAP
+static TfLiteStatus claim_default_instance(void*(*alloc_fnc)(size_t,size_t)) {
+  if (default_instance_claimed) {
+    ei_printf("ERR: model instance is already in use (static arena, one instance)\n");
+    return kTfLiteError;
+  }
+  TfLiteStatus status = init_instance(&default_instance, alloc_fnc);
+  default_instance_claimed = status == kTfLiteOk;
+  return status;
+}
+#endif
+
+} // namespace
+
+TfLiteStatus tflite_learn_796726_5_init( void*(*alloc_fnc)(size_t,size_t) ) {
+#ifdef EI_CLASSIFIER_ALLOCATION_HEAP
+  return init_instance(&default_instance, alloc_fnc);
+#else
+  return claim_default_instance(alloc_fnc);
+#endif
+}
+
+TfLiteStatus tflite_learn_796726_5_input(int index, TfLiteTensor *tensor) {
+  init_tflite_tensor(&default_instance, in_tensor_indices[index], tensor);
+  return kTfLiteOk;
+}
+
+TfLiteStatus tflite_learn_796726_5_output(int index, TfLiteTensor *tensor) {
+  init_tflite_tensor(&default_instance, out_tensor_indices[index], tensor);
+  return kTfLiteOk;
+}
+
+TfLiteStatus tflite_learn_796726_5_invoke() {
+  return invoke_instance(&default_instance);
+}
+
+size_t tflite_learn_796726_5_batch_arena_size(size_t batches) {
+  size_t end = 0;
+  for (size_t i = 0; i < 11; ++i) {
+    if (is_arena_tensor(i) && arena_offset(i) + tensorData[i].bytes > end) {
+      end = arena_offset(i) + tensorData[i].bytes;
+    }
+  }
+  return end * batches;
+}
+
+TfLiteStatus tflite_learn_796726_5_invoke_batch(size_t batches, uint8_t *arena, const void *input, void *output) {
+  return invoke_batch_instance(&default_instance, batches, arena, input, output);
+}
+
+TfLiteStatus tflite_learn_796726_5_reset( void (*free_fnc)(void* ptr) ) {
+#ifndef EI_CLASSIFIER_ALLOCATION_HEAP
+  default_instance_claimed = false;
+#endif
+  return reset_instance(&default_instance, free_fnc);
+}
+
+TfLiteStatus tflite_learn_796726_5_init_instance(void **instance, void*(*alloc_fnc)(size_t,size_t)) {
+#ifdef EI_CLASSIFIER_ALLOCATION_HEAP
+  EonInstance* inst = (EonInstance*) alloc_fnc(16, sizeof(EonInstance));
+  if (!inst) {
+    ei_printf("ERR: failed to allocate model instance\n");
+    return kTfLiteError;
+  }
+  *instance = inst;
+  return init_instance(inst, alloc_fnc);
+#else
+  // one arena, so one instance, and only one owner at a time
+  TfLiteStatus status = claim_default_instance(alloc_fnc);
+  *instance = status == kTfLiteOk ? &default_instance : nullptr;
+  return status;
+#endif
+}
+
+TfLiteStatus tflite_learn_796726_5_input_instance(void *instance, int index, TfLiteTensor *tensor) {
+  init_tflite_tensor((EonInstance*)instance, in_tensor_indices[index], tensor);
+  return kTfLiteOk;
+}
+
+TfLiteStatus tflite_learn_796726_5_output_instance(void *instance, int index, TfLiteTensor *tensor) {
+  init_tflite_tensor((EonInstance*)instance, out_tensor_indices[index], tensor);
+  return kTfLiteOk;
+}
+
+TfLiteStatus tflite_learn_796726_5_invoke_instance(void *instance) {
+  return invoke_instance((EonInstance*)instance);
+}
+
+TfLiteStatus tflite_learn_796726_5_invoke_batch_instance(void *instance, size_t batches, uint8_t *arena, const void *input, void *output) {
+  return invoke_batch_instance((EonInstance*)instance, batches, arena, input, output);
+}
+
+TfLiteStatus tflite_learn_796726_5_reset_instance(void *instance, void (*free_fnc)(void* ptr)) {
+  if (!instance) {
+    return kTfLiteOk;
+  }
+  TfLiteStatus status = reset_instance((EonInstance*)instance, free_fnc);
+#ifdef EI_CLASSIFIER_ALLOCATION_HEAP
+  free_fnc(instance);
+#else
+  default_instance_claimed = false;
+#endif
+  return status;
+}
@@ -43,9 +43,27 @@ TfLiteStatus tflite_learn_796726_5_input(int index, TfLiteTensor* tensor);
 TfLiteStatus tflite_learn_796726_5_output(int index, TfLiteTensor* tensor);
 // Runs inference for the model.
 TfLiteStatus tflite_learn_796726_5_invoke();
+// Bytes of scratch tflite_learn_796726_5_invoke_batch needs for `batches` rows.
+size_t tflite_learn_796726_5_batch_arena_size(size_t batches);
+// Runs inference on `batches` stacked inputs in one go (after init), with
+// the intermediate tensors in `arena`. `input` and `output` hold `batches`
+// rows laid out like the input and output tensors.
+TfLiteStatus tflite_learn_796726_5_invoke_batch(size_t batches, uint8_t *arena, const void *input, void *output);
 //Frees memory allocated
 TfLiteStatus tflite_learn_796726_5_reset( void (*free)(void* ptr) );
 
+// Same as the functions above, on a separate instance of the model's mutable
+// state (tensor arena, node and tensor tables); the weights are shared. Each
+// thread running the model at the same time needs its own instance. With a
+// statically allocated arena there is only one instance to hand out.
+// Call tflite_learn_796726_5_reset_instance once done, also if init failed.
+TfLiteStatus tflite_learn_796726_5_init_instance(void **instance, void*(*alloc_fnc)(size_t,size_t));
+TfLiteStatus tflite_learn_796726_5_input_instance(void *instance, int index, TfLiteTensor* tensor);
+TfLiteStatus tflite_learn_796726_5_output_instance(void *instance, int index, TfLiteTensor* tensor);
+TfLiteStatus tflite_learn_796726_5_invoke_instance(void *instance);
+TfLiteStatus tflite_learn_796726_5_invoke_batch_instance(void *instance, size_t batches, uint8_t *arena, const void *input, void *output);
+TfLiteStatus tflite_learn_796726_5_reset_instance(void *instance, void (*free)(void* ptr));
+
 
 // Returns the number of input tensors.
 inline size_t tflite_learn_796726_5_inputs() {
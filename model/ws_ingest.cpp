@@ -0,0 +1,180 @@
+#include "ws_ingest.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "event_detector.h"
+#include "metrics.h"
+#include "ring_window.h"
+#include "sample_parse.h"
+#include "ws_server.h"
+
+namespace {
+
+// Per-connection state, one device per connection
+struct Device {
+    explicit Device(const WsIngestConfig &config)
+        : window(config.window_size)
+        , samples_seen(0)
+        , detector(config.threshold, config.release, config.min_consecutive, config.refractory)
+    { }
+
+    RingWindow window;
+    uint64_t samples_seen;
+    EventDetector detector;
+    std::string partial;    // incomplete last line of the previous message
+};
+
+class WsIngest {
+public:
+    WsIngest(const WsIngestConfig &config, classify_fn_t classify)
+        : config_(config)
+        , classify_(classify)
+        , snapshot_(config.window_size)
+        , scores_(config.label_count)
+        , arrival_us_(0)
+    { }
+
+    void open(uint32_t conn_id) {
+        devices_[conn_id].reset(new Device(config_));
+        ei_printf("ws: connection %u opened\n", (unsigned)conn_id);
+    }
+
+    void close(uint32_t conn_id) {
+        std::map<uint32_t, std::unique_ptr<Device> >::iterator it = devices_.find(conn_id);
+        if (it == devices_.end()) {
+            return;
+        }
+        Device *device = it->second.get();
+
+        EventDetector::Event event;
+        if (config_.events && device->detector.flush(device->samples_seen, &event)) {
+            emit_event(conn_id, event);
+        }
+        ei_printf("ws: connection %u closed after %llu samples\n", (unsigned)conn_id,
+                  (unsigned long long)device->samples_seen);
+        devices_.erase(it);
+    }
+
+    void message(uint32_t conn_id, const char *data, size_t len) {
+        std::map<uint32_t, std::unique_ptr<Device> >::iterator it = devices_.find(conn_id);
+        if (it == devices_.end()) {
+            return;
+        }
+        Device *device = it->second.get();
+
+        arrival_us_ = ei_read_timer_us();
+
+        const char *p = data;
+        const char *end = data + len;
+
+        // finish a line split across two messages first
+        if (!device->partial.empty()) {
+            const char *eol = (const char *)memchr(p, '\n', end - p);
+            if (eol == nullptr) {
+                device->partial.append(p, end);
+                return;
+            }
+            device->partial.append(p, eol);
+            push_line(conn_id, device, device->partial.data(),
+                      device->partial.data() + device->partial.size());
+            device->partial.clear();
+            p = eol + 1;
+        }
+
+        while (p < end) {
+            const char *eol = (const char *)memchr(p, '\n', end - p);
+            if (eol == nullptr) {
+                device->partial.assign(p, end);
+                break;
+            }
+            push_line(conn_id, device, p, eol);
+            p = eol + 1;
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    void push_line(uint32_t conn_id, Device *device, const char *p, const char *end) {
+        float imu;
+        if (!parse_imu_line(p, end, &imu)) {
+            metrics.parse_errors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        device->window.push(imu);
+        device->samples_seen++;
+        metrics.samples.fetch_add(1, std::memory_order_relaxed);
+
+        if (device->samples_seen < config_.window_size ||
+            (device->samples_seen - config_.window_size) % config_.hop != 0) {
+            return;
+        }
+
+        device->window.read(0, config_.window_size, snapshot_.data());
+        uint32_t dsp_us, classification_us;
+        if (!classify_(snapshot_.data(), config_.window_size, &dsp_us, &classification_us,
+                       scores_.data())) {
+            return;
+        }
+        metrics.record_window(dsp_us, classification_us, arrival_us_);
+
+        if (config_.events) {
+            EventDetector::Event event;
+            if (device->detector.update(scores_[config_.event_ix], device->samples_seen, &event)) {
+                emit_event(conn_id, event);
+            }
+            return;
+        }
+
+        std::printf("PRED ");
+        for (size_t ix = 0; ix < config_.label_count; ix++) {
+            std::printf("%s=%.3f ", config_.labels[ix], scores_[ix]);
+        }
+        std::printf("conn=%u sample=%llu\n", (unsigned)conn_id,
+                    (unsigned long long)device->samples_seen);
+    }
+
+    void emit_event(uint32_t conn_id, const EventDetector::Event &event) {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), " conn=%u", (unsigned)conn_id);
+        print_event(stdout, config_.labels[config_.event_ix], event, suffix);
+    }
+
+    const WsIngestConfig config_;
+    classify_fn_t classify_;
+    std::map<uint32_t, std::unique_ptr<Device> > devices_;
+
+    // scratch, everything runs on the server thread
+    std::vector<float> snapshot_;
+    std::vector<float> scores_;
+    uint64_t arrival_us_;   // when the message being parsed came in
+};
+
+} // namespace
+
+int serve_websocket(uint16_t port, const char *path, const WsIngestConfig &config,
+                    classify_fn_t classify, const volatile sig_atomic_t *stop) {
+    WsIngest ingest(config, classify);
+
+    WsServer server(path,
+                    [&](uint32_t conn_id) { ingest.open(conn_id); },
+                    [&](uint32_t conn_id, const char *data, size_t len) {
+                        ingest.message(conn_id, data, len);
+                    },
+                    [&](uint32_t conn_id) { ingest.close(conn_id); });
+
+    if (!server.listen(port)) {
+        return 1;
+    }
+    ei_printf("ei_stdin_infer: listening on ws://0.0.0.0:%u%s (IMU only, hop %lu)...\n",
+              (unsigned)port, path, (unsigned long)config.hop);
+
+    server.run(stop);
+    return 0;
+}
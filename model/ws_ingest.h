@@ -0,0 +1,37 @@
+#ifndef WS_INGEST_H
+#define WS_INGEST_H
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "classify_fn.h"
+
+struct WsIngestConfig {
+    size_t window_size;
+    size_t hop;
+    const char **labels;
+    size_t label_count;
+
+    // --events: report start/end of events on labels[event_ix] instead of
+    // printing every window
+    bool events;
+    size_t event_ix;
+    float threshold;
+    float release;
+    size_t min_consecutive;
+    uint64_t refractory;
+};
+
+// Accept the device firmware directly: listen for WebSocket connections on
+// `port` / `path`, parse every "mic,imu" text batch straight into that
+// connection's own sliding window and classify in-process whenever a window
+// is due. Results go to stdout as text, PRED lines (or event lines with
+// `events`) tagged with the connection id.
+//
+// Runs on the calling thread until *stop becomes non-zero. Returns non-zero
+// if the port can't be opened.
+int serve_websocket(uint16_t port, const char *path, const WsIngestConfig &config,
+                    classify_fn_t classify, const volatile sig_atomic_t *stop);
+
+#endif // WS_INGEST_H
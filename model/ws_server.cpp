@@ -0,0 +1,516 @@
+#include "ws_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+// Largest reassembled message we accept; a 1000-line batch is ~12 KB
+static const size_t MAX_MESSAGE_BYTES = 4 * 1024 * 1024;
+
+// Largest payload of a control frame (close, ping, pong)
+static const size_t MAX_CONTROL_BYTES = 125;
+
+// Close status for a frame that breaks the protocol
+static const uint16_t CLOSE_PROTOCOL_ERROR = 1002;
+
+// Largest HTTP upgrade request we accept
+static const size_t MAX_HANDSHAKE_BYTES = 8 * 1024;
+
+static const char *WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+enum {
+    OP_CONTINUATION = 0x0,
+    OP_TEXT = 0x1,
+    OP_BINARY = 0x2,
+    OP_CLOSE = 0x8,
+    OP_PING = 0x9,
+    OP_PONG = 0xa
+};
+
+// SHA-1, only used for Sec-WebSocket-Accept
+static void sha1(const uint8_t *data, size_t len, uint8_t digest[20]) {
+    uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+    std::vector<uint8_t> msg(data, data + len);
+    msg.push_back(0x80);
+    while (msg.size() % 64 != 56) {
+        msg.push_back(0);
+    }
+    const uint64_t bits = (uint64_t)len * 8;
+    for (int ix = 7; ix >= 0; ix--) {
+        msg.push_back((uint8_t)(bits >> (ix * 8)));
+    }
+
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int ix = 0; ix < 16; ix++) {
+            const uint8_t *p = &msg[chunk + ix * 4];
+            w[ix] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+        for (int ix = 16; ix < 80; ix++) {
+            uint32_t v = w[ix - 3] ^ w[ix - 8] ^ w[ix - 14] ^ w[ix - 16];
+            w[ix] = (v << 1) | (v >> 31);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int ix = 0; ix < 80; ix++) {
+            uint32_t f, k;
+            if (ix < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            }
+            else if (ix < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            }
+            else if (ix < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            }
+            else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            uint32_t t = ((a << 5) | (a >> 27)) + f + e + k + w[ix];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int ix = 0; ix < 5; ix++) {
+        digest[ix * 4 + 0] = (uint8_t)(h[ix] >> 24);
+        digest[ix * 4 + 1] = (uint8_t)(h[ix] >> 16);
+        digest[ix * 4 + 2] = (uint8_t)(h[ix] >> 8);
+        digest[ix * 4 + 3] = (uint8_t)h[ix];
+    }
+}
+
+static std::string base64(const uint8_t *data, size_t len) {
+    static const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t ix = 0; ix < len; ix += 3) {
+        uint32_t v = (uint32_t)data[ix] << 16;
+        if (ix + 1 < len) v |= (uint32_t)data[ix + 1] << 8;
+        if (ix + 2 < len) v |= data[ix + 2];
+        out += chars[(v >> 18) & 0x3f];
+        out += chars[(v >> 12) & 0x3f];
+        out += ix + 1 < len ? chars[(v >> 6) & 0x3f] : '=';
+        out += ix + 2 < len ? chars[v & 0x3f] : '=';
+    }
+    return out;
+}
+
+// Value of an HTTP header (case-insensitive name), empty if missing
+static std::string header_value(const std::string &request, const char *name) {
+    const size_t name_len = strlen(name);
+    size_t pos = request.find("\r\n");
+    while (pos != std::string::npos && pos + 2 < request.size()) {
+        size_t line = pos + 2;
+        size_t eol = request.find("\r\n", line);
+        if (eol == std::string::npos) {
+            break;
+        }
+        if (eol - line > name_len && request[line + name_len] == ':' &&
+            strncasecmp(request.c_str() + line, name, name_len) == 0) {
+            size_t v = line + name_len + 1;
+            while (v < eol && (request[v] == ' ' || request[v] == '\t')) {
+                v++;
+            }
+            size_t v_end = eol;
+            while (v_end > v && (request[v_end - 1] == ' ' || request[v_end - 1] == '\t')) {
+                v_end--;
+            }
+            return request.substr(v, v_end - v);
+        }
+        pos = eol;
+    }
+    return std::string();
+}
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+WsServer::WsServer(const char *path, on_open_fn_t on_open, on_message_fn_t on_message,
+                   on_close_fn_t on_close)
+    : path_(path)
+    , on_open_(on_open)
+    , on_message_(on_message)
+    , on_close_(on_close)
+    , listen_fd_(-1)
+    , epoll_fd_(-1)
+    , next_id_(0)
+{
+}
+
+WsServer::~WsServer() {
+    while (!conns_.empty()) {
+        close_conn(conns_.begin()->second.get());
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+bool WsServer::listen(uint16_t port) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        ei_printf("ERR: socket: %s\n", strerror(errno));
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, 64) != 0 || !set_nonblocking(listen_fd_)) {
+        ei_printf("ERR: cannot listen on port %u: %s\n", (unsigned)port, strerror(errno));
+        return false;
+    }
+
+    epoll_fd_ = epoll_create1(0);
+    if (epoll_fd_ < 0) {
+        ei_printf("ERR: epoll_create1: %s\n", strerror(errno));
+        return false;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev) == 0;
+}
+
+void WsServer::run(const volatile sig_atomic_t *stop) {
+    struct epoll_event events[64];
+
+    while (!*stop) {
+        int n = epoll_wait(epoll_fd_, events, 64, 500);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ei_printf("ERR: epoll_wait: %s\n", strerror(errno));
+            return;
+        }
+
+        for (int ix = 0; ix < n; ix++) {
+            const int fd = events[ix].data.fd;
+            if (fd == listen_fd_) {
+                accept_all();
+                continue;
+            }
+
+            std::map<int, std::unique_ptr<Conn> >::iterator it = conns_.find(fd);
+            if (it == conns_.end()) {
+                continue;
+            }
+            Conn *conn = it->second.get();
+
+            if (events[ix].events & EPOLLERR) {
+                close_conn(conn);
+                continue;
+            }
+            if (events[ix].events & EPOLLOUT) {
+                on_writable(conn);
+                if (conns_.find(fd) == conns_.end()) {
+                    continue;
+                }
+            }
+            // on hangup read() drains what's left and then sees EOF
+            if (events[ix].events & (EPOLLIN | EPOLLHUP)) {
+                on_readable(conn);
+            }
+        }
+    }
+}
+
+void WsServer::accept_all() {
+    while (true) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            return; // EAGAIN, or a connection that went away before we got to it
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (!set_nonblocking(fd)) {
+            close(fd);
+            continue;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        conns_[fd].reset(new Conn(fd, next_id_++));
+    }
+}
+
+void WsServer::on_readable(Conn *conn) {
+    uint8_t buf[16 * 1024];
+    bool closed = false;
+    while (true) {
+        ssize_t n = read(conn->fd, buf, sizeof(buf));
+        if (n > 0) {
+            conn->in.insert(conn->in.end(), buf, buf + n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        // EOF or error, but what came in before it (say the last batch and
+        // the close frame) is still handled below
+        closed = true;
+        break;
+    }
+
+    if (!conn->upgraded) {
+        if (!handle_handshake(conn)) {
+            close_conn(conn);
+            return;
+        }
+        if (!conn->upgraded) {
+            if (closed) {
+                close_conn(conn);
+            }
+            return; // request not complete yet
+        }
+    }
+
+    if (!handle_frames(conn) || closed) {
+        close_conn(conn);
+    }
+}
+
+void WsServer::on_writable(Conn *conn) {
+    while (!conn->out.empty()) {
+        ssize_t n = write(conn->fd, conn->out.data(), conn->out.size());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            close_conn(conn);
+            return;
+        }
+        conn->out.erase(conn->out.begin(), conn->out.begin() + n);
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = conn->fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+// Returns false if the connection should be dropped. Leaves conn->upgraded
+// false while the request is still incomplete.
+bool WsServer::handle_handshake(Conn *conn) {
+    static const char *end_marker = "\r\n\r\n";
+    std::vector<uint8_t>::iterator end = std::search(conn->in.begin(), conn->in.end(),
+                                                     end_marker, end_marker + 4);
+    if (end == conn->in.end()) {
+        return conn->in.size() <= MAX_HANDSHAKE_BYTES;
+    }
+    const std::string request(conn->in.begin(), end + 2);
+    conn->in.erase(conn->in.begin(), end + 4);
+
+    // "GET /ws HTTP/1.1"
+    const std::string expected = "GET " + path_ + " ";
+    const std::string key = header_value(request, "Sec-WebSocket-Key");
+    if (request.compare(0, expected.size(), expected) != 0 || key.empty()) {
+        static const char *not_found =
+            "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        if (write(conn->fd, not_found, strlen(not_found)) < 0) {
+            // dropping the connection anyway
+        }
+        return false;
+    }
+
+    const std::string accept_src = key + WS_GUID;
+    uint8_t digest[20];
+    sha1((const uint8_t *)accept_src.data(), accept_src.size(), digest);
+
+    const std::string response =
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + base64(digest, sizeof(digest)) + "\r\n\r\n";
+    send(conn, response.data(), response.size());
+
+    conn->upgraded = true;
+    on_open_(conn->id);
+    return true;
+}
+
+// Consume every complete frame in conn->in. Returns false if the
+// connection should be dropped.
+bool WsServer::handle_frames(Conn *conn) {
+    size_t pos = 0;
+    const std::vector<uint8_t> &in = conn->in;
+
+    while (in.size() - pos >= 2) {
+        const uint8_t *p = &in[pos];
+        const bool fin = (p[0] & 0x80) != 0;
+        const uint8_t opcode = p[0] & 0x0f;
+        const bool masked = (p[1] & 0x80) != 0;
+        uint64_t len = p[1] & 0x7f;
+        size_t header = 2;
+
+        if (len == 126) {
+            if (in.size() - pos < 4) break;
+            len = ((uint64_t)p[2] << 8) | p[3];
+            header = 4;
+        }
+        else if (len == 127) {
+            if (in.size() - pos < 10) break;
+            len = 0;
+            for (int ix = 0; ix < 8; ix++) {
+                len = (len << 8) | p[2 + ix];
+            }
+            header = 10;
+        }
+
+        // control frames are never fragmented and carry at most 125 bytes
+        // (RFC 6455 section 5.5), anything else is a protocol error
+        if (opcode >= OP_CLOSE && (!fin || len > MAX_CONTROL_BYTES)) {
+            const uint8_t status[2] = { (uint8_t)(CLOSE_PROTOCOL_ERROR >> 8),
+                                        (uint8_t)(CLOSE_PROTOCOL_ERROR & 0xff) };
+            send_close(conn, status, sizeof(status));
+            return false;
+        }
+
+        // clients must mask, and nothing we accept is this big
+        if (!masked || len > MAX_MESSAGE_BYTES) {
+            return false;
+        }
+        if (in.size() - pos < header + 4 + len) {
+            break;
+        }
+
+        const uint8_t *mask = p + header;
+        const uint8_t *payload = mask + 4;
+        pos += header + 4 + (size_t)len;
+
+        if (opcode >= OP_CLOSE) {
+            // control frames can come in between the fragments of a message
+            std::vector<uint8_t> body((size_t)len);
+            for (size_t ix = 0; ix < body.size(); ix++) {
+                body[ix] = payload[ix] ^ mask[ix & 3];
+            }
+            if (opcode == OP_PING) {
+                send_frame(conn, OP_PONG, body.data(), body.size());
+            }
+            else if (opcode == OP_CLOSE) {
+                // echo the status code
+                send_close(conn, body.data(), body.size() >= 2 ? 2 : 0);
+                return false;
+            }
+            continue;
+        }
+
+        if (opcode == OP_TEXT || opcode == OP_BINARY) {
+            conn->msg_opcode = opcode;
+            conn->msg.clear();
+        }
+        else if (opcode != OP_CONTINUATION || conn->msg_opcode == 0) {
+            return false;
+        }
+        if (conn->msg.size() + len > MAX_MESSAGE_BYTES) {
+            return false;
+        }
+
+        size_t at = conn->msg.size();
+        conn->msg.resize(at + (size_t)len);
+        for (size_t ix = 0; ix < len; ix++) {
+            conn->msg[at + ix] = (char)(payload[ix] ^ mask[ix & 3]);
+        }
+
+        if (fin) {
+            on_message_(conn->id, conn->msg.data(), conn->msg.size());
+            conn->msg.clear();
+            conn->msg_opcode = 0;
+        }
+    }
+
+    conn->in.erase(conn->in.begin(), conn->in.begin() + pos);
+    return true;
+}
+
+void WsServer::send(Conn *conn, const void *data, size_t len) {
+    const bool was_empty = conn->out.empty();
+    conn->out.insert(conn->out.end(), (const uint8_t *)data, (const uint8_t *)data + len);
+    if (!was_empty) {
+        return; // EPOLLOUT is already armed
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.fd = conn->fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+bool WsServer::send_frame(Conn *conn, uint8_t opcode, const uint8_t *payload, size_t len) {
+    // server frames are unmasked and only ever control frames, which have a
+    // one byte length
+    if (len > MAX_CONTROL_BYTES) {
+        return false;
+    }
+    uint8_t header[2] = { (uint8_t)(0x80 | opcode), (uint8_t)len };
+    send(conn, header, sizeof(header));
+    send(conn, payload, len);
+    return true;
+}
+
+void WsServer::send_close(Conn *conn, const uint8_t *payload, size_t len) {
+    send_frame(conn, OP_CLOSE, payload, len);
+    // best effort, the connection is dropped right after
+    if (write(conn->fd, conn->out.data(), conn->out.size()) < 0) {
+        // dropping the connection anyway
+    }
+}
+
+void WsServer::close_conn(Conn *conn) {
+    const int fd = conn->fd;
+    if (conn->upgraded) {
+        on_close_(conn->id);
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    conns_.erase(fd);
+}
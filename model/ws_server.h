@@ -0,0 +1,71 @@
+#ifndef WS_SERVER_H
+#define WS_SERVER_H
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Minimal single-threaded WebSocket server (RFC 6455) on epoll, enough for
+// the ESP32 firmware: it accepts upgrades on one path, reassembles
+// fragmented messages, answers ping and close, and hands every complete
+// text or binary message to a callback. Nothing is ever sent to clients
+// apart from control frames.
+//
+// Linux only.
+class WsServer {
+public:
+    typedef std::function<void(uint32_t conn_id)> on_open_fn_t;
+    typedef std::function<void(uint32_t conn_id, const char *data, size_t len)> on_message_fn_t;
+    typedef std::function<void(uint32_t conn_id)> on_close_fn_t;
+
+    WsServer(const char *path, on_open_fn_t on_open, on_message_fn_t on_message,
+             on_close_fn_t on_close);
+    ~WsServer();
+
+    // Bind and listen on all interfaces. Returns false (and logs) on error.
+    bool listen(uint16_t port);
+
+    // Serve until *stop becomes non-zero (set from a signal handler)
+    void run(const volatile sig_atomic_t *stop);
+
+private:
+    struct Conn {
+        explicit Conn(int fd, uint32_t id)
+            : fd(fd), id(id), upgraded(false), msg_opcode(0) { }
+        int fd;
+        uint32_t id;
+        bool upgraded;
+        std::vector<uint8_t> in;     // bytes received but not consumed yet
+        std::vector<uint8_t> out;    // bytes still to be written
+        uint8_t msg_opcode;          // opcode of the message being reassembled
+        std::vector<char> msg;       // payload of the message so far
+    };
+
+    void accept_all();
+    void on_readable(Conn *conn);
+    void on_writable(Conn *conn);
+    bool handle_handshake(Conn *conn);
+    bool handle_frames(Conn *conn);
+    void send(Conn *conn, const void *data, size_t len);
+    bool send_frame(Conn *conn, uint8_t opcode, const uint8_t *payload, size_t len);
+    void send_close(Conn *conn, const uint8_t *payload, size_t len);
+    void close_conn(Conn *conn);
+
+    const std::string path_;
+    on_open_fn_t on_open_;
+    on_message_fn_t on_message_;
+    on_close_fn_t on_close_;
+
+    int listen_fd_;
+    int epoll_fd_;
+    uint32_t next_id_;
+    std::map<int, std::unique_ptr<Conn> > conns_;
+};
+
+#endif // WS_SERVER_H